@@ -0,0 +1,60 @@
+#include "Arena.hpp"
+#include "read_chunk.hpp"
+
+#include <stdexcept>
+
+Arena::Arena() {
+	add_pillar(glm::vec3( 2.0f, 0.0f, 0.2f), 0.2f, 0.38f);
+	add_pillar(glm::vec3(-2.0f, 0.0f, 0.2f), 0.2f, 0.38f);
+}
+
+void Arena::add_pillar(glm::vec3 const &position, float radius, float reach) {
+	pillar_x.emplace_back(position.x);
+	pillar_y.emplace_back(position.y);
+	pillar_z.emplace_back(position.z);
+	pillar_radius2.emplace_back(radius * radius);
+	pillar_reach2.emplace_back(reach * reach);
+}
+
+void Arena::clear_pillars() {
+	pillar_x.clear();
+	pillar_y.clear();
+	pillar_z.clear();
+	pillar_radius2.clear();
+	pillar_reach2.clear();
+}
+
+void Arena::load(std::istream &from) {
+	struct ColliderEntry {
+		uint32_t type; //0 = field, 1 = pillar
+		glm::vec3 position; //pillar: centre
+		float radius; //pillar: how close balls get
+		float reach; //pillar: how close spin stuff get
+		glm::vec2 half_size; //field: goal lines at +/- x, side walls at +/- y
+	};
+	static_assert(sizeof(ColliderEntry) == 32, "Collider entry should be packed");
+
+	std::vector< ColliderEntry > data;
+	read_chunk(from, "col0", &data);
+
+	bool have_field = false;
+	clear_pillars();
+	for (auto const &entry : data) {
+		if (entry.type == 0) {
+			if (have_field) throw std::runtime_error("collider chunk has more than one field");
+			if (!(entry.half_size.x > 0.0f && entry.half_size.y > 0.0f)) {
+				throw std::runtime_error("collider chunk has an empty field");
+			}
+			half_size = entry.half_size;
+			have_field = true;
+		} else if (entry.type == 1) {
+			if (!(entry.radius > 0.0f && entry.reach > 0.0f)) {
+				throw std::runtime_error("collider chunk has a pillar with no size");
+			}
+			add_pillar(entry.position, entry.radius, entry.reach);
+		} else {
+			throw std::runtime_error("collider chunk has an entry of unknown type");
+		}
+	}
+	if (!have_field) throw std::runtime_error("collider chunk has no field");
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <iosfwd>
+#include <vector>
+#include <cstdint>
+
+//Numbers that set how the game plays (what the montecarlo tool varies for balance testing):
+struct Tuning {
+	//ball friction, as speed lost per second, inside and outside the centre circle:
+	float inner_friction = 0.18f;
+	float outer_friction = 1.2f;
+	//balls slower than (this * elapsed) stop dead:
+	float inner_stop = 0.06f;
+	float outer_stop = 0.6f;
+	float paddle_speed = 1.2f; //spin stuff movement, units per second
+	float hit_impulse = 2.6f; //speed a spin stuff hit adds to the ball
+};
+
+//The arena's colliders: the field's goal lines and side walls, and pillars.
+// main.cpp loads them from the 'col0' chunk of scene_spin.blob (written by
+// models/export-meshes_spin.py); a default-constructed Arena is the original
+// two-pillar field. Pillars are kept as parallel arrays so the rules can test
+// every pillar in one loop without branching on which one it is.
+// The arena also carries the tuning the match is played with.
+
+struct Arena {
+	Arena(); //the original field: pillars at (+/-2, 0), goals at x = +/-3.1, walls at y = +/-1.52
+
+	//goal lines are at x = +/- half_size.x, side walls at y = +/- half_size.y:
+	glm::vec2 half_size = glm::vec2(3.1f, 1.52f);
+
+	std::vector< float > pillar_x, pillar_y, pillar_z;
+	std::vector< float > pillar_radius2; //balls centred closer than this (squared) bounce off
+	std::vector< float > pillar_reach2; //spin stuff centred closer than this (squared) are blocked
+
+	uint32_t pillar_count() const { return uint32_t(pillar_x.size()); }
+	void add_pillar(glm::vec3 const &position, float radius, float reach);
+	void clear_pillars();
+
+	Tuning tuning;
+
+	//replace the colliders with the contents of a 'col0' chunk (throws on bad data):
+	void load(std::istream &from);
+};
@@ -0,0 +1,131 @@
+#include "BallGrid.hpp"
+#include "Buckets.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+//fraction of the closing speed two balls keep after bouncing:
+static const float Restitution = 0.9f;
+
+BallGrid::BallGrid(glm::vec2 const &min_, glm::vec2 const &max_) : min(min_), cell_size(2.0f * BallRadius) {
+	assert(max_.x > min_.x && max_.y > min_.y);
+	columns = std::max(1U, uint32_t(std::ceil((max_.x - min_.x) / cell_size)));
+	rows = std::max(1U, uint32_t(std::ceil((max_.y - min_.y) / cell_size)));
+}
+
+uint32_t BallGrid::cell_of(float px, float py) const {
+	float cx = std::floor((px - min.x) / cell_size);
+	float cy = std::floor((py - min.y) / cell_size);
+	uint32_t col = (cx > 0.0f ? std::min(columns - 1, uint32_t(cx)) : 0);
+	uint32_t row = (cy > 0.0f ? std::min(rows - 1, uint32_t(cy)) : 0);
+	return row * columns + col;
+}
+
+//bounce packed balls a and b off each other if they touch:
+static bool bounce(BallGrid &grid, uint32_t a, uint32_t b) {
+	const float Diameter = 2.0f * BallRadius;
+	float dx = grid.x[b] - grid.x[a];
+	float dy = grid.y[b] - grid.y[a];
+	float dist2 = dx * dx + dy * dy;
+	if (!(dist2 < Diameter * Diameter)) return false;
+	float dist = std::sqrt(dist2);
+	//(balls exactly on top of each other get pushed apart along x)
+	float nx = (dist > 0.0f ? dx / dist : 1.0f);
+	float ny = (dist > 0.0f ? dy / dist : 0.0f);
+
+	//push them apart, half each:
+	float push = 0.5f * (Diameter - dist);
+	grid.x[a] -= nx * push; grid.y[a] -= ny * push;
+	grid.x[b] += nx * push; grid.y[b] += ny * push;
+
+	//equal masses, so they swap (most of) their closing velocity:
+	float closing = (grid.vx[b] - grid.vx[a]) * nx + (grid.vy[b] - grid.vy[a]) * ny;
+	if (closing < 0.0f) {
+		float j = 0.5f * (1.0f + Restitution) * closing;
+		grid.vx[a] += j * nx; grid.vy[a] += j * ny;
+		grid.vx[b] -= j * nx; grid.vy[b] -= j * ny;
+	}
+	return true;
+}
+
+uint32_t collide_balls(BallGrid &grid, BallArrays const *sets, uint32_t set_count) {
+	uint32_t total = 0;
+	for (uint32_t s = 0; s < set_count; ++s) {
+		total += sets[s].count;
+	}
+	if (total < 2) return 0;
+	const uint32_t cells = grid.columns * grid.rows;
+	const uint32_t Parked = cells; //extra cell for balls below the floor
+
+	//counting sort by cell:
+	grid.cell.resize(total);
+	grid.slot.resize(total);
+	grid.cell_start.assign(cells + 2, 0);
+	for (uint32_t s = 0, g = 0; s < set_count; ++s) {
+		BallArrays const &set = sets[s];
+		for (uint32_t i = 0; i < set.count; ++i, ++g) {
+			uint32_t c = (set.z[i] < 0.0f ? Parked : grid.cell_of(set.x[i], set.y[i]));
+			grid.cell[g] = c;
+			grid.cell_start[c] += 1;
+		}
+	}
+	bucket_ends(&grid.cell_start, Parked + 1);
+	assert(grid.cell_start[Parked + 1] == total);
+	for (uint32_t g = total; g > 0; --g) { //(backward, so each cell's balls stay in order)
+		grid.slot[g-1] = --grid.cell_start[grid.cell[g-1]];
+	}
+
+	//gather into packed arrays:
+	grid.x.resize(total); grid.y.resize(total);
+	grid.vx.resize(total); grid.vy.resize(total);
+	for (uint32_t s = 0, g = 0; s < set_count; ++s) {
+		BallArrays const &set = sets[s];
+		for (uint32_t i = 0; i < set.count; ++i, ++g) {
+			uint32_t k = grid.slot[g];
+			grid.x[k] = set.x[i]; grid.y[k] = set.y[i];
+			grid.vx[k] = set.vx[i]; grid.vy[k] = set.vy[i];
+		}
+	}
+
+	//each cell checks itself and the neighbours after it (so every pair is checked once):
+	uint32_t touching = 0;
+	for (uint32_t row = 0; row < grid.rows; ++row) {
+		for (uint32_t col = 0; col < grid.columns; ++col) {
+			uint32_t c = row * grid.columns + col;
+			uint32_t begin = grid.cell_start[c], end = grid.cell_start[c+1];
+			if (begin == end) continue;
+			uint32_t neighbours[4];
+			uint32_t neighbour_count = 0;
+			if (col + 1 < grid.columns) neighbours[neighbour_count++] = c + 1;
+			if (row + 1 < grid.rows) {
+				if (col > 0) neighbours[neighbour_count++] = c + grid.columns - 1;
+				neighbours[neighbour_count++] = c + grid.columns;
+				if (col + 1 < grid.columns) neighbours[neighbour_count++] = c + grid.columns + 1;
+			}
+			for (uint32_t a = begin; a < end; ++a) {
+				for (uint32_t b = a + 1; b < end; ++b) {
+					if (bounce(grid, a, b)) ++touching;
+				}
+				for (uint32_t n = 0; n < neighbour_count; ++n) {
+					for (uint32_t b = grid.cell_start[neighbours[n]]; b < grid.cell_start[neighbours[n]+1]; ++b) {
+						if (bounce(grid, a, b)) ++touching;
+					}
+				}
+			}
+		}
+	}
+
+	//scatter results back (parked balls weren't touched):
+	for (uint32_t s = 0, g = 0; s < set_count; ++s) {
+		BallArrays const &set = sets[s];
+		for (uint32_t i = 0; i < set.count; ++i, ++g) {
+			if (grid.cell[g] == Parked) continue;
+			uint32_t k = grid.slot[g];
+			set.x[i] = grid.x[k]; set.y[i] = grid.y[k];
+			set.vx[i] = grid.vx[k]; set.vy[i] = grid.vy[k];
+		}
+	}
+
+	return touching;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Balls.hpp"
+
+#include <vector>
+#include <cstdint>
+
+//Ball-ball collisions, found with a uniform grid over the field.
+// Cells are one ball diameter across, so touching balls are always in the
+// same or neighbouring cells. Every update the balls are counting-sorted by
+// cell into packed arrays; contacts are resolved on those packed arrays
+// (neighbours sit next to each other in memory) and the results copied back.
+
+struct BallGrid {
+	//cover the rectangle min..max (balls outside it are counted in the edge cells):
+	BallGrid(glm::vec2 const &min, glm::vec2 const &max);
+
+	glm::vec2 min;
+	float cell_size; //one ball diameter
+	uint32_t columns, rows;
+
+	//rebuilt every update:
+	// (balls are numbered through all the sets in order; parked balls go in one extra cell at the end)
+	std::vector< uint32_t > cell_start; //balls in cell c are at [cell_start[c], cell_start[c+1]) in the packed arrays
+	std::vector< uint32_t > cell; //ball -> cell
+	std::vector< uint32_t > slot; //ball -> place in the packed arrays
+	std::vector< float > x, y, vx, vy; //packed copies
+
+	uint32_t cell_of(float px, float py) const;
+};
+
+//bounce touching balls off each other (and push them apart); 'sets' are all
+// the ball arrays in play together (e.g. the match ball and the extra balls).
+// Balls parked below the floor after scoring are left alone.
+// Returns the number of touching pairs found:
+uint32_t collide_balls(BallGrid &grid, BallArrays const *sets, uint32_t set_count);
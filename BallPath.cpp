@@ -0,0 +1,230 @@
+#include "BallPath.hpp"
+#include "Balls.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+//distance along the line after k ticks (friction comes off before each tick's move, as in step_balls):
+struct Run {
+	double speed; //units per second at the start
+	double slow; //speed lost per tick
+	double distance(uint32_t k) const {
+		return TickElapsed * (k * speed - slow * 0.5 * double(k) * double(k + 1));
+	}
+	//first k >= 1 with distance(k) >= length, or -1U if the run slows to a halt first:
+	uint32_t reach(double length) const {
+		double guess;
+		if (slow == 0.0) {
+			guess = length / (TickElapsed * speed);
+		} else {
+			double b = speed - 0.5 * slow;
+			double disc = b * b - 2.0 * slow * length / TickElapsed;
+			if (disc < 0.0) return -1U;
+			guess = (b - std::sqrt(disc)) / slow;
+		}
+		if (!(guess < 1e9)) return -1U;
+		uint32_t k = uint32_t(std::max(1.0, std::ceil(guess)));
+		//(clean up rounding in the solve)
+		while (k > 1 && distance(k - 1) >= length) --k;
+		for (uint32_t i = 0; i < 4 && distance(k) < length; ++i) ++k;
+		return (distance(k) >= length ? k : -1U);
+	}
+};
+
+//distances along the line p + d * s (d unit length) that are inside the circle, or false if none:
+bool circle_span(glm::vec2 const &p, glm::vec2 const &d, glm::vec2 const &center, float radius2, double *enter, double *exit) {
+	if (radius2 <= 0.0f) return false;
+	double ox = p.x - center.x, oy = p.y - center.y;
+	double b = ox * d.x + oy * d.y;
+	double c = ox * ox + oy * oy - radius2;
+	double disc = b * b - c;
+	if (disc < 0.0) return false;
+	double root = std::sqrt(disc);
+	*enter = -b - root;
+	*exit = -b + root;
+	return *exit > 0.0;
+}
+
+} //namespace
+
+BallPath::BallPath(Arena const &arena, GameState::Ball const &ball, float horizon) : z(ball.position.z) {
+	const uint32_t limit = uint32_t(std::ceil(std::max(0.0f, horizon) / TickElapsed));
+	const glm::vec2 half = arena.half_size;
+	//balls centred in these circles are in the centre circle, or touching a pillar (see Balls.cpp):
+	const float inner_radius2 = 1.0f - z * z;
+	std::vector< glm::vec2 > pillar_center;
+	std::vector< float > pillar_radius2;
+	for (uint32_t p = 0; p < arena.pillar_count(); ++p) {
+		float dz = z - arena.pillar_z[p];
+		pillar_center.emplace_back(arena.pillar_x[p], arena.pillar_y[p]);
+		pillar_radius2.emplace_back(arena.pillar_radius2[p] - dz * dz);
+	}
+	auto in_pillar = [&](glm::vec2 const &at) {
+		for (uint32_t p = 0; p < pillar_center.size(); ++p) {
+			glm::vec2 to = at - pillar_center[p];
+			if (to.x * to.x + to.y * to.y < pillar_radius2[p]) return true;
+		}
+		return false;
+	};
+
+	GameState::Ball at = ball;
+	int32_t winner = -1;
+	uint32_t tick = 0;
+	while (tick < limit) {
+		if (winner != -1) {
+			scorer = winner;
+			break;
+		}
+		glm::vec2 position = glm::vec2(at.position);
+		glm::vec2 velocity = glm::vec2(at.velocity);
+		float speed = std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y);
+		if (speed == 0.0f) {
+			stopped = true;
+			break;
+		}
+		glm::vec2 direction = velocity / speed;
+		bool inner = (glm::dot(position, position) + z * z < 1.0f);
+		Run run;
+		run.speed = speed;
+		run.slow = (inner ? arena.tuning.inner_friction : arena.tuning.outer_friction) * TickElapsed;
+		double stop = (inner ? arena.tuning.inner_stop : arena.tuning.outer_stop) * TickElapsed;
+
+		//how many ticks can go by in closed form (tick k is fine if nothing happens during it):
+		uint32_t ticks = limit - tick;
+		if (in_pillar(position) || std::abs(position.y) >= half.y || std::abs(position.x) >= half.x) {
+			ticks = 0; //(bouncing right now)
+		}
+		//speed: a tick starting at or below 'stop' stops the ball, and one ending below zero turns it around:
+		if (run.slow > 0.0) {
+			double full = std::floor(run.speed / run.slow);
+			double moving = std::ceil((run.speed - stop) / run.slow);
+			ticks = uint32_t(std::min< double >(ticks, std::max(0.0, std::min(full, moving))));
+		} else if (run.speed <= stop) {
+			ticks = 0;
+		}
+		//walls and goal lines: the tick that reaches one is a bounce (or a goal):
+		auto lines = [&](float p, float d, float line) {
+			if (d == 0.0f) return;
+			double length = ((d > 0.0f ? line : -line) - p) / d;
+			uint32_t k = run.reach(length);
+			if (k != -1U) ticks = std::min(ticks, k - 1);
+		};
+		lines(position.x, direction.x, half.x);
+		lines(position.y, direction.y, half.y);
+		//circles: tick k + 1 runs with different friction (or bounces) if the ball is in (or out) after tick k:
+		auto circle = [&](glm::vec2 const &center, float radius2, bool leaving) {
+			double enter, exit;
+			if (!circle_span(position, direction, center, radius2, &enter, &exit)) return;
+			if (leaving) {
+				uint32_t k = run.reach(exit);
+				if (k != -1U) ticks = std::min(ticks, k);
+			} else {
+				uint32_t k = run.reach(std::max(0.0, enter));
+				//(a ball fast enough to skip over the edge of a circle never lands inside it)
+				if (k != -1U && run.distance(k) < exit) ticks = std::min(ticks, k);
+			}
+		};
+		circle(glm::vec2(0.0f), inner_radius2, inner);
+		for (uint32_t p = 0; p < pillar_center.size(); ++p) {
+			circle(pillar_center[p], pillar_radius2[p], false);
+		}
+
+		Segment segment;
+		segment.tick = tick;
+		segment.position = position;
+		segment.direction = direction;
+		segment.speed = speed;
+		if (ticks > 0) {
+			segment.ticks = ticks;
+			segment.slow = float(run.slow);
+			glm::vec2 moved = position + direction * float(run.distance(ticks));
+			float speed_after = float(run.speed - run.slow * ticks);
+			at.position.x = moved.x;
+			at.position.y = moved.y;
+			at.velocity.x = direction.x * speed_after;
+			at.velocity.y = direction.y * speed_after;
+		} else {
+			//something happens this tick, so run it by the rules:
+			segment.ticks = ticks = 1;
+			segment.slow = 0.0f;
+			step_balls(arena, nullptr, 0, ball_arrays(at), TickElapsed, &winner);
+		}
+		segments.emplace_back(segment);
+		tick += ticks;
+	}
+	if (winner != -1) scorer = winner;
+	end_tick = tick;
+	end_position = at.position;
+}
+
+glm::vec3 BallPath::position_at_tick(uint32_t tick) const {
+	if (tick >= end_tick || segments.empty()) return end_position;
+	auto after = std::upper_bound(segments.begin(), segments.end(), tick, [](uint32_t t, Segment const &s) {
+		return t < s.tick;
+	});
+	assert(after != segments.begin());
+	Segment const &s = *(after - 1);
+	uint32_t k = tick - s.tick;
+	double distance = TickElapsed * (k * double(s.speed) - s.slow * 0.5 * double(k) * double(k + 1));
+	glm::vec2 at = s.position + s.direction * float(distance);
+	return glm::vec3(at, z);
+}
+
+glm::vec3 BallPath::position(float seconds) const {
+	float ticks = std::max(0.0f, seconds) / TickElapsed;
+	float whole = std::floor(ticks);
+	uint32_t tick = uint32_t(std::min(whole, float(end_tick)));
+	glm::vec3 before = position_at_tick(tick);
+	if (tick >= end_tick) return before;
+	//(no sliding into the parking spot when scoring)
+	if (tick + 1 == end_tick && scorer != -1) return before;
+	return glm::mix(before, position_at_tick(tick + 1), ticks - whole);
+}
+
+bool BallPath::time_to_x(float x, float *seconds) const {
+	assert(seconds);
+	if (segments.empty()) return false;
+	float start = segments[0].position.x;
+	float toward = (start <= x ? 1.0f : -1.0f);
+	for (uint32_t i = 0; i < segments.size(); ++i) {
+		Segment const &s = segments[i];
+		float from = toward * (s.position.x - x);
+		if (from >= 0.0f) {
+			*seconds = s.tick * TickElapsed;
+			return true;
+		}
+		//where the segment ends (a goal parks the ball, so it counts as reaching the line):
+		bool last = (i + 1 == segments.size());
+		if (last && scorer != -1) {
+			if (toward * (scorer == 0 ? 1.0f : -1.0f) > 0.0f) {
+				*seconds = end_tick * TickElapsed;
+				return true;
+			}
+			return false;
+		}
+		float end = (last ? end_position.x : segments[i + 1].position.x);
+		if (toward * (end - x) < 0.0f) continue;
+		if (s.ticks == 1 || toward * s.direction.x <= 0.0f) {
+			*seconds = (s.tick + s.ticks) * TickElapsed;
+			return true;
+		}
+		Run run;
+		run.speed = s.speed;
+		run.slow = s.slow;
+		uint32_t k = run.reach(-from / (toward * s.direction.x));
+		*seconds = (s.tick + std::min(k, s.ticks)) * TickElapsed;
+		return true;
+	}
+	return false;
+}
+
+bool BallPath::time_to_goal(float *seconds, int32_t *scorer_) const {
+	assert(seconds);
+	if (scorer == -1) return false;
+	*seconds = end_tick * TickElapsed;
+	if (scorer_) *scorer_ = scorer;
+	return true;
+}
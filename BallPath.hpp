@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Game.hpp"
+
+#include <vector>
+#include <cstdint>
+
+//Where a ball goes from here if no spin stuff touches it, without stepping every tick:
+// between events the ball moves in a straight line losing a fixed speed per tick, so its
+// position after k ticks is a closed-form sum. The path is split at the ticks where that
+// stops being true -- crossing into or out of the centre circle (friction changes),
+// touching a pillar, reaching a wall or goal line, slowing to a stop -- and those ticks
+// are run with the real ball rules (step_balls), so the path matches the rules tick for
+// tick (up to float rounding). A path has a handful of segments, so building one is
+// near-constant time, and queries are a binary search plus a quadratic.
+
+struct BallPath {
+	//follow 'ball' for (at most) 'horizon' seconds:
+	BallPath(Arena const &arena, GameState::Ball const &ball, float horizon = 10.0f);
+
+	//a stretch of ticks [tick, tick + ticks) of straight-line motion:
+	// position k ticks in is position + direction * TickElapsed * (k * speed - slow * k * (k + 1) / 2)
+	struct Segment {
+		uint32_t tick;
+		uint32_t ticks;
+		glm::vec2 position;
+		glm::vec2 direction; //(unit length)
+		float speed; //units per second at 'tick'
+		float slow; //speed lost per tick
+	};
+	std::vector< Segment > segments;
+	float z; //(balls stay at one height)
+
+	//how the path ends (at end_tick): the ball scored, stopped, or the horizon ran out:
+	uint32_t end_tick = 0;
+	glm::vec3 end_position = glm::vec3(0.0f); //(a scored ball is parked, as step_balls does)
+	int32_t scorer = -1; //player who scores, if the ball goes in
+	bool stopped = false;
+
+	//position after 'tick' ticks (past end_tick: end_position):
+	glm::vec3 position_at_tick(uint32_t tick) const;
+	//position after 'seconds', interpolated between ticks:
+	glm::vec3 position(float seconds) const;
+
+	//seconds until the ball first reaches (or passes) x -- the goal lines are x = +/-arena.half_size.x;
+	// returns false if it doesn't within the path:
+	bool time_to_x(float x, float *seconds) const;
+	//seconds until the ball goes in (and who scores), or false if it doesn't within the path:
+	bool time_to_goal(float *seconds, int32_t *scorer = nullptr) const;
+};
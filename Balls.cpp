@@ -0,0 +1,315 @@
+#include "Balls.hpp"
+#include "BallGrid.hpp"
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+//SIMD versions of the candidate test are picked at compile time
+// (build with -mavx or /arch:AVX for the 8-wide one):
+#if defined(__AVX__)
+#define SPIN_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPIN_SSE
+#include <emmintrin.h>
+#endif
+
+void Balls::add(glm::vec3 const &position, glm::vec3 const &velocity) {
+	x.emplace_back(position.x);
+	y.emplace_back(position.y);
+	z.emplace_back(position.z);
+	vx.emplace_back(velocity.x);
+	vy.emplace_back(velocity.y);
+	hit.emplace_back(0);
+}
+
+void Balls::clear() {
+	x.clear();
+	y.clear();
+	z.clear();
+	vx.clear();
+	vy.clear();
+	hit.clear();
+}
+
+uint32_t balls_hash(Balls const &balls) {
+	StateHash sum;
+	for (uint32_t i = 0; i < balls.size(); ++i) {
+		sum.add(balls.x[i]);
+		sum.add(balls.y[i]);
+		sum.add(balls.z[i]);
+		sum.add(balls.vx[i]);
+		sum.add(balls.vy[i]);
+		sum.add(uint32_t(balls.hit[i]));
+	}
+	return sum.finish();
+}
+
+BallArrays Balls::arrays() {
+	BallArrays ret;
+	ret.x = x.data();
+	ret.y = y.data();
+	ret.z = z.data();
+	ret.vx = vx.data();
+	ret.vy = vy.data();
+	ret.hit = hit.data();
+	ret.count = size();
+	return ret;
+}
+
+BallArrays ball_arrays(GameState::Ball &ball) {
+	BallArrays ret;
+	ret.x = &ball.position.x;
+	ret.y = &ball.position.y;
+	ret.z = &ball.position.z;
+	ret.vx = &ball.velocity.x;
+	ret.vy = &ball.velocity.y;
+	ret.hit = &ball.hit;
+	ret.count = 1;
+	return ret;
+}
+
+//---------------------------
+
+//Candidate test, shared by the scalar and SIMD versions below. However it turns,
+// the spin stuff's box stays inside a vertical cylinder of radius SpinReach around
+// its pivot, so a ball is a candidate if it is level with that cylinder and no
+// farther from it than the two can close in one update. The SIMD versions do
+// exactly the same float operations in the same order, so all versions make
+// bit-identical decisions.
+struct CandidateTest {
+	CandidateTest(SpinMotion const &spin, float elapsed_) : elapsed(elapsed_) {
+		glm::vec3 spin_velocity = (spin.end - spin.start) / elapsed;
+		sx = spin.start.x; sy = spin.start.y;
+		svx = spin_velocity.x; svy = spin_velocity.y;
+		z_min = spin.start.z + SpinBoxMin.z - BallRadius;
+		z_max = spin.start.z + SpinBoxMax.z + BallRadius;
+	}
+	float sx, sy; //pivot
+	float svx, svy; //pivot velocity
+	float z_min, z_max; //ball centres outside this range can't touch
+	float elapsed;
+};
+
+static const float CandidateReach = SpinReach + BallRadius;
+
+static void candidates_scalar(CandidateTest const &c, BallArrays const &balls, uint32_t begin, uint8_t *candidates) {
+	for (uint32_t i = begin; i < balls.count; ++i) {
+		float dx = balls.x[i] - c.sx;
+		float dy = balls.y[i] - c.sy;
+		float gap = std::sqrt(dx * dx + dy * dy) - CandidateReach;
+		float rvx = balls.vx[i] - c.svx;
+		float rvy = balls.vy[i] - c.svy;
+		float approach = std::sqrt(rvx * rvx + rvy * rvy) * c.elapsed;
+		float z = balls.z[i];
+		candidates[i] = (gap <= approach && z >= c.z_min && z <= c.z_max ? 1 : 0);
+	}
+}
+
+#if defined(SPIN_SSE)
+static uint32_t candidates_sse(CandidateTest const &c, BallArrays const &balls, uint8_t *candidates) {
+	const __m128 sx = _mm_set1_ps(c.sx), sy = _mm_set1_ps(c.sy);
+	const __m128 svx = _mm_set1_ps(c.svx), svy = _mm_set1_ps(c.svy);
+	const __m128 z_min = _mm_set1_ps(c.z_min), z_max = _mm_set1_ps(c.z_max);
+	const __m128 reach = _mm_set1_ps(CandidateReach), elapsed = _mm_set1_ps(c.elapsed);
+	uint32_t i = 0;
+	for (; i + 4 <= balls.count; i += 4) {
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(balls.x + i), sx);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(balls.y + i), sy);
+		__m128 gap = _mm_sub_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))), reach);
+		__m128 rvx = _mm_sub_ps(_mm_loadu_ps(balls.vx + i), svx);
+		__m128 rvy = _mm_sub_ps(_mm_loadu_ps(balls.vy + i), svy);
+		__m128 approach = _mm_mul_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(rvx, rvx), _mm_mul_ps(rvy, rvy))), elapsed);
+		__m128 z = _mm_loadu_ps(balls.z + i);
+		__m128 hit = _mm_and_ps(_mm_cmple_ps(gap, approach), _mm_and_ps(_mm_cmpge_ps(z, z_min), _mm_cmple_ps(z, z_max)));
+		int mask = _mm_movemask_ps(hit);
+		for (uint32_t j = 0; j < 4; ++j) {
+			candidates[i + j] = (mask >> j) & 1;
+		}
+	}
+	return i;
+}
+#endif
+
+#if defined(SPIN_AVX)
+static uint32_t candidates_avx(CandidateTest const &c, BallArrays const &balls, uint8_t *candidates) {
+	const __m256 sx = _mm256_set1_ps(c.sx), sy = _mm256_set1_ps(c.sy);
+	const __m256 svx = _mm256_set1_ps(c.svx), svy = _mm256_set1_ps(c.svy);
+	const __m256 z_min = _mm256_set1_ps(c.z_min), z_max = _mm256_set1_ps(c.z_max);
+	const __m256 reach = _mm256_set1_ps(CandidateReach), elapsed = _mm256_set1_ps(c.elapsed);
+	uint32_t i = 0;
+	for (; i + 8 <= balls.count; i += 8) {
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(balls.x + i), sx);
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(balls.y + i), sy);
+		__m256 gap = _mm256_sub_ps(_mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy))), reach);
+		__m256 rvx = _mm256_sub_ps(_mm256_loadu_ps(balls.vx + i), svx);
+		__m256 rvy = _mm256_sub_ps(_mm256_loadu_ps(balls.vy + i), svy);
+		__m256 approach = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(rvx, rvx), _mm256_mul_ps(rvy, rvy))), elapsed);
+		__m256 z = _mm256_loadu_ps(balls.z + i);
+		__m256 hit = _mm256_and_ps(_mm256_cmp_ps(gap, approach, _CMP_LE_OQ),
+			_mm256_and_ps(_mm256_cmp_ps(z, z_min, _CMP_GE_OQ), _mm256_cmp_ps(z, z_max, _CMP_LE_OQ)));
+		int mask = _mm256_movemask_ps(hit);
+		for (uint32_t j = 0; j < 8; ++j) {
+			candidates[i + j] = (mask >> j) & 1;
+		}
+	}
+	return i;
+}
+#endif
+
+void spin_ball_candidates_scalar(SpinMotion const &spin, BallArrays const &balls, float elapsed, uint8_t *candidates) {
+	candidates_scalar(CandidateTest(spin, elapsed), balls, 0, candidates);
+}
+
+void spin_ball_candidates(SpinMotion const &spin, BallArrays const &balls, float elapsed, uint8_t *candidates) {
+	CandidateTest test(spin, elapsed);
+	uint32_t done = 0;
+#if defined(SPIN_AVX)
+	done = candidates_avx(test, balls, candidates);
+#elif defined(SPIN_SSE)
+	done = candidates_sse(test, balls, candidates);
+#endif
+	candidates_scalar(test, balls, done, candidates); //leftovers
+}
+
+char const *spin_ball_candidates_isa() {
+#if defined(SPIN_AVX)
+	return "avx";
+#elif defined(SPIN_SSE)
+	return "sse";
+#else
+	return "scalar";
+#endif
+}
+
+//spin stuff hits: push (once per contact) any ball the spin stuff touches during the update:
+static void hit_balls(Tuning const &tuning, SpinMotion const &spin, uint8_t bit, BallArrays const &balls, float elapsed) {
+	//work in chunks so the candidate flags can live on the stack:
+	const uint32_t Chunk = 256;
+	uint8_t candidates[Chunk];
+	for (uint32_t begin = 0; begin < balls.count; begin += Chunk) {
+		BallArrays chunk = balls;
+		chunk.x += begin; chunk.y += begin; chunk.z += begin;
+		chunk.vx += begin; chunk.vy += begin;
+		chunk.hit += begin;
+		chunk.count = std::min(Chunk, balls.count - begin);
+		spin_ball_candidates(spin, chunk, elapsed, candidates);
+
+		for (uint32_t i = 0; i < chunk.count; ++i) {
+			float toi = 0.0f;
+			if (!candidates[i] || !spin_sweep_ball(spin.start, spin.end, spin.angle_start, spin.spin_rate,
+				glm::vec3(chunk.x[i], chunk.y[i], chunk.z[i]), glm::vec3(chunk.vx[i], chunk.vy[i], 0.0f), elapsed, &toi)) {
+				chunk.hit[i] &= ~bit;
+				continue;
+			}
+			if (!(chunk.hit[i] & bit)) {
+				glm::vec3 impulse = tuning.hit_impulse * spin.normal;
+				chunk.vx[i] += impulse.x;
+				chunk.vy[i] += impulse.y;
+				//the ball only moves at its new velocity for the part of the update after the hit:
+				chunk.x[i] -= impulse.x * toi;
+				chunk.y[i] -= impulse.y * toi;
+			}
+			chunk.hit[i] |= bit;
+		}
+	}
+}
+
+//friction, heavier outside the centre circle:
+// (rates are per second; they match the old per-frame values at 60fps)
+static void apply_friction(Tuning const &tuning, BallArrays const &balls, float elapsed) {
+	for (uint32_t i = 0; i < balls.count; ++i) {
+		float x = balls.x[i], y = balls.y[i], z = balls.z[i];
+		float vx = balls.vx[i], vy = balls.vy[i];
+		bool inner = (x * x + y * y + z * z < 1.0f);
+		float slow = (inner ? tuning.inner_friction : tuning.outer_friction) * elapsed;
+		float stop = (inner ? tuning.inner_stop : tuning.outer_stop) * elapsed;
+		float speed = std::sqrt(vx * vx + vy * vy);
+		float scale = (speed > stop ? (speed - slow) / speed : 0.0f);
+		balls.vx[i] = vx * scale;
+		balls.vy[i] = vy * scale;
+	}
+}
+
+//pillars bounce the ball outward, keeping its speed:
+static void bounce_pillars(Arena const &arena, BallArrays const &balls) {
+	const uint32_t pillars = arena.pillar_count();
+	float const *pillar_x = arena.pillar_x.data();
+	float const *pillar_y = arena.pillar_y.data();
+	float const *pillar_z = arena.pillar_z.data();
+	float const *pillar_radius2 = arena.pillar_radius2.data();
+	for (uint32_t i = 0; i < balls.count; ++i) {
+		float x = balls.x[i], y = balls.y[i], z = balls.z[i];
+		//find the first pillar the ball is inside (all are tested, so the loop doesn't branch):
+		uint32_t inside = pillars;
+		for (uint32_t p = pillars; p > 0; --p) {
+			float dx = x - pillar_x[p-1];
+			float dy = y - pillar_y[p-1];
+			float dz = z - pillar_z[p-1];
+			inside = (dx * dx + dy * dy + dz * dz < pillar_radius2[p-1] ? p-1 : inside);
+		}
+		if (inside == pillars) continue;
+		float dx = x - pillar_x[inside];
+		float dy = y - pillar_y[inside];
+		float dz = z - pillar_z[inside];
+		float dist = std::sqrt(dx * dx + dy * dy + dz * dz);
+		float vx = balls.vx[i], vy = balls.vy[i];
+		float speed = std::sqrt(vx * vx + vy * vy);
+		balls.vx[i] = 0.8f * vx + speed * dx / dist;
+		balls.vy[i] = 0.8f * vy + speed * dy / dist;
+	}
+}
+
+static void integrate(BallArrays const &balls, float elapsed) {
+	for (uint32_t i = 0; i < balls.count; ++i) {
+		balls.x[i] += balls.vx[i] * elapsed;
+		balls.y[i] += balls.vy[i] * elapsed;
+	}
+}
+
+static void bounce_walls(Arena const &arena, BallArrays const &balls) {
+	for (uint32_t i = 0; i < balls.count; ++i) {
+		if (balls.y[i] >= arena.half_size.y || balls.y[i] <= -arena.half_size.y) {
+			balls.vy[i] = -balls.vy[i];
+		}
+	}
+}
+
+//balls past either end score, and are parked below the floor:
+static void score_goals(Arena const &arena, BallArrays const &balls, int32_t *winner) {
+	for (uint32_t i = 0; i < balls.count; ++i) {
+		int32_t scorer = -1;
+		if (balls.x[i] >= arena.half_size.x) scorer = 0;
+		else if (balls.x[i] <= -arena.half_size.x) scorer = 1;
+		if (scorer == -1) continue;
+		balls.x[i] = 0.0f;
+		balls.y[i] = 0.0f;
+		balls.z[i] = -1.0f;
+		balls.vx[i] = 0.0f;
+		balls.vy[i] = 0.0f;
+		if (*winner == -1) *winner = scorer;
+	}
+}
+
+void step_balls(Arena const &arena, SpinMotion const *spins, uint32_t spin_count, BallArrays const &balls, float elapsed, int32_t *winner) {
+	assert(winner);
+	assert(spin_count <= 8 && "hit flags are one bit per spin stuff");
+	for (uint32_t s = 0; s < spin_count; ++s) {
+		hit_balls(arena.tuning, spins[s], uint8_t(1 << s), balls, elapsed);
+	}
+	apply_friction(arena.tuning, balls, elapsed);
+	bounce_pillars(arena, balls);
+	integrate(balls, elapsed);
+	bounce_walls(arena, balls);
+	score_goals(arena, balls, winner);
+}
+
+void step(Arena const &arena, GameState &state, Balls &balls, BallGrid &grid, GameInputs const &inputs, float elapsed) {
+	SpinMotion spins[2];
+	step_spins(arena, state, inputs, elapsed, spins);
+	BallArrays sets[2] = { ball_arrays(state.ball), balls.arrays() };
+	step_balls(arena, spins, 2, sets[0], elapsed, &state.winner);
+	step_balls(arena, spins, 2, sets[1], elapsed, &state.winner);
+	collide_balls(grid, sets, 2);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Game.hpp"
+
+#include <vector>
+#include <cstdint>
+
+//Balls are stored as parallel arrays ("structure of arrays") so the ball rules
+// can run as tight loops over contiguous floats. Balls always sit on the floor
+// (or are parked below it after scoring), so there is no z velocity.
+
+//Non-owning view of some ball arrays (what the rules operate on):
+struct BallArrays {
+	float *x = nullptr;
+	float *y = nullptr;
+	float *z = nullptr;
+	float *vx = nullptr;
+	float *vy = nullptr;
+	uint8_t *hit = nullptr; //bit i set: was touching spin stuff i last update
+	uint32_t count = 0;
+};
+
+//Storage for the extra balls of multi-ball mode:
+// (to snapshot, assign to a Balls kept around for the purpose -- once it is the
+//  right size that is six memcpys with no allocation)
+struct Balls {
+	std::vector< float > x, y, z;
+	std::vector< float > vx, vy;
+	std::vector< uint8_t > hit;
+
+	uint32_t size() const { return uint32_t(x.size()); }
+	void add(glm::vec3 const &position, glm::vec3 const &velocity = glm::vec3(0.0f));
+	void clear();
+
+	BallArrays arrays();
+};
+
+//hash of every ball (see StateHash in Game.hpp; roll it in alongside state_hash in multi-ball mode):
+uint32_t balls_hash(Balls const &balls);
+
+//view of the match ball in a GameState as a one-element array:
+BallArrays ball_arrays(GameState::Ball &ball);
+
+//flag (candidates[i] = 1) the balls that could touch 'spin' during this update; only
+// those need the (much more expensive) spin_sweep_ball test. Tests 4 or 8 balls
+// at a time with SSE/AVX when the build allows it:
+void spin_ball_candidates(SpinMotion const &spin, BallArrays const &balls, float elapsed, uint8_t *candidates);
+//one-at-a-time version (makes bit-identical decisions; for checking the SIMD one):
+void spin_ball_candidates_scalar(SpinMotion const &spin, BallArrays const &balls, float elapsed, uint8_t *candidates);
+//which version spin_ball_candidates uses ("avx", "sse", or "scalar"):
+char const *spin_ball_candidates_isa();
+
+//run the ball rules (spin stuff hits, friction, pillars, walls, goals) on every ball in 'balls';
+// sets *winner if it is still -1 and some ball scores:
+void step_balls(Arena const &arena, SpinMotion const *spins, uint32_t spin_count, BallArrays const &balls, float elapsed, int32_t *winner);
+
+struct BallGrid; //see BallGrid.hpp
+
+//multi-ball step: like step(arena, state, inputs, elapsed), but 'balls' are in play alongside state.ball
+// (and all of them bounce off each other; 'grid' should cover the arena's field):
+void step(Arena const &arena, GameState &state, Balls &balls, BallGrid &grid, GameInputs const &inputs, float elapsed);
@@ -0,0 +1,21 @@
+#include "Bot.hpp"
+
+#include <cassert>
+
+PlayerInput chase_ball(GameState const &state, uint32_t player) {
+	assert(player < 2);
+	//player 0 scores past +x (so stays on the -x side of the ball), player 1 the reverse;
+	// aiming a little closer than the blade reaches means it keeps hitting the ball:
+	float behind = (player == 0 ? -0.25f : 0.25f);
+	glm::vec3 target = state.ball.position + glm::vec3(behind, 0.0f, 0.0f);
+	glm::vec3 to_target = target - state.paddles[player].position;
+
+	//(controls are named as the right player sees them: "right" is -x, "up" is -y)
+	const float DeadZone = 0.05f;
+	PlayerInput input;
+	input.right = (to_target.x < -DeadZone);
+	input.left = (to_target.x > DeadZone);
+	input.up = (to_target.y < -DeadZone);
+	input.down = (to_target.y > DeadZone);
+	return input;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "Game.hpp"
+
+//Scripted players, for tools that play matches without people (montecarlo, tests of the AI):
+
+//steer player 'player's spin stuff to just behind the ball (on the side of the goal it
+// defends), close enough that the blade keeps hitting it; never toggles the spin:
+PlayerInput chase_ball(GameState const &state, uint32_t player);
@@ -0,0 +1,105 @@
+#include "Broadphase.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+bool broadphase_tests(Broadphase::Kind a, Broadphase::Kind b) {
+	//anything involving spin stuff, plus balls bouncing off pillars:
+	if (a == Broadphase::Paddle || b == Broadphase::Paddle) return true;
+	return a != b;
+}
+
+uint32_t Broadphase::add(Kind kind, uint32_t index, glm::vec2 const &min, glm::vec2 const &max) {
+	uint32_t id = uint32_t(proxies.size());
+	proxies.emplace_back();
+	proxies.back().kind = kind;
+	proxies.back().index = index;
+	proxies.back().min = min;
+	proxies.back().max = max;
+	//(the next update sorts it into its bands)
+	return id;
+}
+
+void Broadphase::clear() {
+	proxies.clear();
+	pairs.clear();
+	for (auto &band : bands) {
+		band.clear();
+	}
+}
+
+void Broadphase::set_bands(float min_y, float height, uint32_t count) {
+	assert(height > 0.0f && count > 0);
+	band_min_y = min_y;
+	band_height = height;
+	bands.assign(count, std::vector< uint32_t >());
+	//everything gets sorted in from scratch next update:
+	for (auto &proxy : proxies) {
+		proxy.band_first = 1;
+		proxy.band_last = 0;
+	}
+}
+
+uint32_t Broadphase::band_of(float y) const {
+	float band = std::floor((y - band_min_y) / band_height);
+	if (!(band > 0.0f)) return 0;
+	return std::min(uint32_t(bands.size()) - 1, uint32_t(band));
+}
+
+void Broadphase::update() {
+	//move proxies between bands (new entries go at the end and get sorted in below):
+	for (uint32_t id = 0; id < proxies.size(); ++id) {
+		Proxy &proxy = proxies[id];
+		uint32_t first = band_of(proxy.min.y);
+		uint32_t last = band_of(proxy.max.y);
+		for (uint32_t b = first; b <= last; ++b) {
+			if (b < proxy.band_first || b > proxy.band_last) bands[b].emplace_back(id);
+		}
+		proxy.band_first = first;
+		proxy.band_last = last;
+	}
+
+	swaps = 0;
+	pairs.clear();
+	for (uint32_t band = 0; band < bands.size(); ++band) {
+		std::vector< uint32_t > &order = bands[band];
+		//drop proxies that left this band:
+		order.erase(std::remove_if(order.begin(), order.end(), [this, band](uint32_t id) {
+			return band < proxies[id].band_first || band > proxies[id].band_last;
+		}), order.end());
+
+		//insertion sort by min.x -- cheap, since the order from last update is nearly right:
+		for (uint32_t i = 1; i < order.size(); ++i) {
+			uint32_t id = order[i];
+			float key = proxies[id].min.x;
+			uint32_t j = i;
+			while (j > 0 && proxies[order[j-1]].min.x > key) {
+				order[j] = order[j-1];
+				--j;
+			}
+			swaps += i - j;
+			order[j] = id;
+		}
+
+		//sweep: each proxy only needs checking against the ones that start before it ends:
+		for (uint32_t i = 0; i < order.size(); ++i) {
+			Proxy const &a = proxies[order[i]];
+			for (uint32_t j = i + 1; j < order.size(); ++j) {
+				Proxy const &b = proxies[order[j]];
+				if (b.min.x > a.max.x) break;
+				if (b.min.y > a.max.y || a.min.y > b.max.y) continue;
+				if (!broadphase_tests(a.kind, b.kind)) continue;
+				//pairs that share several bands are reported from the one their overlap starts in:
+				if (band_of(std::max(a.min.y, b.min.y)) != band) continue;
+				Pair pair;
+				pair.a = order[i];
+				pair.b = order[j];
+				if (a.kind > b.kind || (a.kind == b.kind && pair.a > pair.b)) {
+					std::swap(pair.a, pair.b);
+				}
+				pairs.emplace_back(pair);
+			}
+		}
+	}
+}
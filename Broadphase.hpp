@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//Sweep-and-prune broadphase over the floor plane.
+// Everything in the arena (spin stuff, balls, pillars) gets a "proxy" with a
+// bounding box in x/y. update() keeps the proxies sorted by the left edge of
+// their boxes and sweeps along x to find every pair whose boxes overlap.
+// The sort order is kept from one update to the next; since things only move
+// a little per tick it is nearly sorted already, and an insertion sort fixes
+// it up in close to linear time.
+//
+// A single sweep over a big square-ish arena still compares each box with
+// everything in the same column of the floor, so the floor can be cut into
+// horizontal bands that are sorted and swept separately (a box spanning two
+// bands goes in both; each pair is only reported from one of them).
+
+struct Broadphase {
+	enum Kind : uint8_t {
+		Paddle = 0,
+		Ball = 1,
+		Pillar = 2,
+	};
+
+	struct Proxy {
+		glm::vec2 min = glm::vec2(0.0f);
+		glm::vec2 max = glm::vec2(0.0f);
+		Kind kind = Paddle;
+		uint32_t index = 0; //which paddle / ball / pillar (caller's numbering)
+		//bands the proxy was sorted into at the last update (none if first > last):
+		uint32_t band_first = 1, band_last = 0;
+	};
+
+	//a pair of proxies whose boxes overlap; 'a' has the lower kind (so
+	// paddle-ball pairs always have the paddle in 'a'), or the lower id if
+	// they are the same kind:
+	struct Pair {
+		uint32_t a, b; //proxy ids
+	};
+
+	Broadphase() : bands(1) { }
+
+	//add a proxy, returning its id (ids are handed out in order, starting at zero):
+	uint32_t add(Kind kind, uint32_t index, glm::vec2 const &min, glm::vec2 const &max);
+	void clear();
+
+	//move a proxy's box (takes effect at the next update):
+	void set_bounds(uint32_t proxy, glm::vec2 const &min, glm::vec2 const &max) {
+		proxies[proxy].min = min;
+		proxies[proxy].max = max;
+	}
+
+	//cut the floor into 'count' bands 'height' tall, starting at y = 'min_y'
+	// (the first and last bands stretch on past the ends):
+	void set_bands(float min_y, float height, uint32_t count);
+
+	//re-sort and find overlapping pairs, replacing the contents of 'pairs':
+	// (pairs between two balls or two pillars are skipped -- nothing tests those)
+	void update();
+
+	std::vector< Proxy > proxies;
+	std::vector< Pair > pairs;
+
+	//per band: ids of the proxies touching it, sorted by min.x (as of the last update):
+	std::vector< std::vector< uint32_t > > bands;
+	float band_min_y = 0.0f;
+	float band_height = 1.0f;
+	uint32_t band_of(float y) const;
+
+	//how many swaps the last update's sorts took (zero when nothing changed places):
+	uint32_t swaps = 0;
+};
+
+//would the broadphase report a pair between these kinds at all?
+bool broadphase_tests(Broadphase::Kind a, Broadphase::Kind b);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+//Sorting items into buckets in two passes (a counting sort, or lists of neighbours
+// packed into one array): count how many items go in each bucket into start[],
+// call bucket_ends(), then put each item of bucket b at --start[b]. That leaves
+// bucket b's items at [start[b], start[b+1]) -- in item order, if the items were
+// placed last to first.
+
+//turn the counts in start[0, buckets) into where each bucket ends (and start[buckets] into the total):
+inline void bucket_ends(std::vector< uint32_t > *start, uint32_t buckets) {
+	std::vector< uint32_t > &s = *start;
+	s.resize(buckets + 1);
+	uint32_t total = 0;
+	for (uint32_t b = 0; b < buckets; ++b) {
+		total += s[b];
+		s[b] = total;
+	}
+	s[buckets] = total;
+}
@@ -0,0 +1,211 @@
+#include "FreeForAll.hpp"
+#include "SimMath.hpp"
+#include "Buckets.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+FreeForAll::FreeForAll(uint32_t players, uint32_t balls_per_player, uint32_t seed) {
+	//players start in the middle of a grid of cells, each about half a normal field:
+	const float Cell = 3.0f;
+	uint32_t columns = std::max(1U, uint32_t(std::ceil(std::sqrt(2.0f * players))));
+	uint32_t rows = std::max(1U, (players + columns - 1) / columns);
+	glm::vec2 half_size = 0.5f * Cell * glm::vec2(float(columns), float(rows));
+	arena.half_size = half_size;
+
+	//(so every platform starts from the same state: mt19937's output is fixed by the standard,
+	// but the distributions aren't, so this turns 24 of its bits into a float in [0, 1) itself)
+	std::mt19937 mt(seed);
+	auto unit = [&mt]() { return float(mt() >> 8) * (1.0f / 16777216.0f); };
+
+	paddles.resize(players);
+	for (uint32_t i = 0; i < players; ++i) {
+		GameState::Paddle &paddle = paddles[i];
+		paddle.position = glm::vec3(
+			-half_size.x + (float(i % columns) + 0.5f) * Cell,
+			-half_size.y + (float(i / columns) + 0.5f) * Cell,
+			0.16f);
+		paddle.angle = unit() * glm::two_pi< float >();
+		paddle.clockwise = (mt() & 1 ? 1.0f : -1.0f);
+	}
+
+	//pillars (the usual size) on every other inside corner of the grid:
+	arena.clear_pillars();
+	for (uint32_t row = 1; row < rows; ++row) {
+		for (uint32_t col = 1; col < columns; ++col) {
+			if ((row + col) % 2) continue;
+			arena.add_pillar(glm::vec3(-half_size.x + float(col) * Cell, -half_size.y + float(row) * Cell, 0.2f), 0.2f, 0.38f);
+		}
+	}
+
+	//balls anywhere on the floor, drifting in random directions:
+	for (uint32_t i = 0; i < players * balls_per_player; ++i) {
+		float x = unit(); //(one at a time: the order arguments are evaluated in isn't fixed either)
+		float y = unit();
+		glm::vec2 at = (2.0f * glm::vec2(x, y) - 1.0f) * (half_size - 0.2f);
+		float heading = unit() * glm::two_pi< float >();
+		float speed = unit();
+		float s, c;
+		sim_sincos(heading, &s, &c);
+		balls.add(glm::vec3(at, 0.2f), speed * glm::vec3(c, s, 0.0f));
+	}
+	touching.clear();
+
+	//broadphase proxies (paddle and ball boxes get set every update), swept a row of cells at a time:
+	broadphase.set_bands(-half_size.y, Cell, rows);
+	for (uint32_t i = 0; i < paddles.size(); ++i) {
+		broadphase.add(Broadphase::Paddle, i, glm::vec2(0.0f), glm::vec2(0.0f));
+	}
+	for (uint32_t i = 0; i < balls.size(); ++i) {
+		broadphase.add(Broadphase::Ball, i, glm::vec2(0.0f), glm::vec2(0.0f));
+	}
+	for (uint32_t i = 0; i < arena.pillar_count(); ++i) {
+		//boxes cover what balls bounce off; spin stuff boxes (SpinReach in radius) reach far enough to cover what blocks them:
+		glm::vec2 at = glm::vec2(arena.pillar_x[i], arena.pillar_y[i]);
+		float radius = std::sqrt(arena.pillar_radius2[i]);
+		assert(std::sqrt(arena.pillar_reach2[i]) <= radius + SpinReach);
+		broadphase.add(Broadphase::Pillar, i, at - radius, at + radius);
+	}
+}
+
+//move one spin stuff, backing off if it would run into anything the broadphase found nearby:
+static void move_paddle(FreeForAll &ffa, uint32_t index, PlayerInput const &input, float elapsed) {
+	GameState::Paddle &paddle = ffa.paddles[index];
+	auto blocked = [&ffa, &paddle, index]() {
+		for (uint32_t b = ffa.blocker_begin[index]; b < ffa.blocker_begin[index+1]; ++b) {
+			Broadphase::Proxy const &proxy = ffa.broadphase.proxies[ffa.blockers[b]];
+			if (proxy.kind == Broadphase::Paddle) {
+				if (spins_collide(paddle.position, ffa.paddles[proxy.index].position)) return true;
+			} else {
+				if (spin_collide_pillar(ffa.arena, proxy.index, paddle.position)) return true;
+			}
+		}
+		return false;
+	};
+	move_spin(ffa.arena, paddle, input, elapsed, blocked);
+	toggle_spin(paddle, input);
+}
+
+void step(FreeForAll &ffa, std::vector< PlayerInput > const &inputs, float elapsed) {
+	Broadphase &broadphase = ffa.broadphase;
+	uint32_t paddle_count = uint32_t(ffa.paddles.size());
+	uint32_t ball_count = ffa.balls.size();
+	assert(broadphase.proxies.size() == paddle_count + ball_count + ffa.arena.pillar_count());
+	BallArrays balls = ffa.balls.arrays();
+
+	//boxes around everywhere each spin stuff or ball could reach this update:
+	float paddle_reach = SpinReach + ffa.arena.tuning.paddle_speed * elapsed;
+	for (uint32_t i = 0; i < paddle_count; ++i) {
+		glm::vec2 at = glm::vec2(ffa.paddles[i].position);
+		broadphase.set_bounds(i, at - paddle_reach, at + paddle_reach);
+	}
+	for (uint32_t i = 0; i < ball_count; ++i) {
+		glm::vec2 from = glm::vec2(balls.x[i], balls.y[i]);
+		glm::vec2 to = from + elapsed * glm::vec2(balls.vx[i], balls.vy[i]);
+		broadphase.set_bounds(paddle_count + i, glm::min(from, to) - BallRadius, glm::max(from, to) + BallRadius);
+	}
+	broadphase.update();
+
+	{ //list what could block each spin stuff (other spin stuff and pillars):
+		std::vector< uint32_t > &begin = ffa.blocker_begin;
+		begin.assign(paddle_count + 1, 0);
+		for (auto const &pair : broadphase.pairs) {
+			Broadphase::Proxy const &a = broadphase.proxies[pair.a];
+			Broadphase::Proxy const &b = broadphase.proxies[pair.b];
+			if (a.kind != Broadphase::Paddle || b.kind == Broadphase::Ball) continue;
+			begin[a.index] += 1;
+			if (b.kind == Broadphase::Paddle) begin[b.index] += 1;
+		}
+		//(each paddle's blockers end up packed together, in no particular order)
+		bucket_ends(&begin, paddle_count);
+		ffa.blockers.resize(begin[paddle_count]);
+		for (auto const &pair : broadphase.pairs) {
+			Broadphase::Proxy const &a = broadphase.proxies[pair.a];
+			Broadphase::Proxy const &b = broadphase.proxies[pair.b];
+			if (a.kind != Broadphase::Paddle || b.kind == Broadphase::Ball) continue;
+			ffa.blockers[--begin[a.index]] = pair.b;
+			if (b.kind == Broadphase::Paddle) ffa.blockers[--begin[b.index]] = pair.a;
+		}
+	}
+
+	//move and spin the spin stuff:
+	ffa.spins.resize(paddle_count);
+	for (uint32_t i = 0; i < paddle_count; ++i) {
+		ffa.spins[i].start = ffa.paddles[i].position;
+		move_paddle(ffa, i, (i < inputs.size() ? inputs[i] : PlayerInput()), elapsed);
+	}
+	for (uint32_t i = 0; i < paddle_count; ++i) {
+		turn_spin(ffa.paddles[i], elapsed, &ffa.spins[i]);
+	}
+
+	//spin stuff hit balls (once per contact, as in a normal match -- per pair, since a ball can touch several at once):
+	ffa.next_touching.clear();
+	for (auto const &pair : broadphase.pairs) {
+		Broadphase::Proxy const &a = broadphase.proxies[pair.a];
+		Broadphase::Proxy const &b = broadphase.proxies[pair.b];
+		if (a.kind != Broadphase::Paddle || b.kind != Broadphase::Ball) continue;
+		SpinMotion const &spin = ffa.spins[a.index];
+		uint32_t i = b.index;
+		float toi = 0.0f;
+		if (!spin_sweep_ball(spin.start, spin.end, spin.angle_start, spin.spin_rate,
+			glm::vec3(balls.x[i], balls.y[i], balls.z[i]), glm::vec3(balls.vx[i], balls.vy[i], 0.0f), elapsed, &toi)) {
+			continue;
+		}
+		uint64_t contact = uint64_t(a.index) << 32 | i;
+		if (!std::binary_search(ffa.touching.begin(), ffa.touching.end(), contact)) {
+			glm::vec3 impulse = ffa.arena.tuning.hit_impulse * spin.normal;
+			balls.vx[i] += impulse.x;
+			balls.vy[i] += impulse.y;
+			balls.x[i] -= impulse.x * toi;
+			balls.y[i] -= impulse.y * toi;
+		}
+		ffa.next_touching.emplace_back(contact);
+	}
+	std::sort(ffa.next_touching.begin(), ffa.next_touching.end());
+	std::swap(ffa.touching, ffa.next_touching);
+
+	//friction (the whole arena is like the outside of the centre circle):
+	Tuning const &tuning = ffa.arena.tuning;
+	for (uint32_t i = 0; i < ball_count; ++i) {
+		float vx = balls.vx[i], vy = balls.vy[i];
+		float speed = std::sqrt(vx * vx + vy * vy);
+		float scale = (speed > tuning.outer_stop * elapsed ? (speed - tuning.outer_friction * elapsed) / speed : 0.0f);
+		balls.vx[i] = vx * scale;
+		balls.vy[i] = vy * scale;
+	}
+
+	//pillars bounce balls outward, keeping their speed:
+	for (auto const &pair : broadphase.pairs) {
+		Broadphase::Proxy const &a = broadphase.proxies[pair.a];
+		Broadphase::Proxy const &b = broadphase.proxies[pair.b];
+		if (a.kind != Broadphase::Ball || b.kind != Broadphase::Pillar) continue;
+		uint32_t i = a.index;
+		Arena const &arena = ffa.arena;
+		float dx = balls.x[i] - arena.pillar_x[b.index];
+		float dy = balls.y[i] - arena.pillar_y[b.index];
+		float dz = balls.z[i] - arena.pillar_z[b.index];
+		float dist2 = dx * dx + dy * dy + dz * dz;
+		if (!(dist2 < arena.pillar_radius2[b.index])) continue;
+		float dist = std::sqrt(dist2);
+		float vx = balls.vx[i], vy = balls.vy[i];
+		float speed = std::sqrt(vx * vx + vy * vy);
+		balls.vx[i] = 0.8f * vx + speed * dx / dist;
+		balls.vy[i] = 0.8f * vy + speed * dy / dist;
+	}
+
+	//move, and bounce off all four walls:
+	for (uint32_t i = 0; i < ball_count; ++i) {
+		balls.x[i] += balls.vx[i] * elapsed;
+		balls.y[i] += balls.vy[i] * elapsed;
+		if ((balls.x[i] >= ffa.arena.half_size.x && balls.vx[i] > 0.0f) || (balls.x[i] <= -ffa.arena.half_size.x && balls.vx[i] < 0.0f)) {
+			balls.vx[i] = -balls.vx[i];
+		}
+		if ((balls.y[i] >= ffa.arena.half_size.y && balls.vy[i] > 0.0f) || (balls.y[i] <= -ffa.arena.half_size.y && balls.vy[i] < 0.0f)) {
+			balls.vy[i] = -balls.vy[i];
+		}
+	}
+}
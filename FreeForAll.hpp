@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Game.hpp"
+#include "Balls.hpp"
+#include "Broadphase.hpp"
+
+#include <vector>
+#include <cstdint>
+
+//Free-for-all: any number of spin stuff and balls in one big walled arena
+// (no goals -- it's for stress-testing the rules with lots of players).
+// Who could touch what is found with the sweep-and-prune broadphase, so the
+// cost of an update grows about linearly with the number of players instead
+// of with every pair of them.
+
+struct FreeForAll {
+	//lays out an arena with about as much room per player as a normal match:
+	FreeForAll(uint32_t players, uint32_t balls_per_player = 2, uint32_t seed = 0);
+
+	Arena arena; //(no goals: balls bounce off walls at x = +/- arena.half_size.x too)
+	std::vector< GameState::Paddle > paddles;
+	Balls balls;
+	//every (paddle, ball) pair that was touching last update, as paddle << 32 | ball, sorted:
+	// (stands in for Balls::hit, which only has room for eight spin stuff)
+	std::vector< uint64_t > touching;
+
+	//broadphase proxies are numbered paddles first, then balls, then pillars:
+	Broadphase broadphase;
+
+	//scratch space reused between updates:
+	std::vector< SpinMotion > spins;
+	std::vector< uint32_t > blocker_begin; //blockers of paddle i are blockers[blocker_begin[i]] up to blocker_begin[i+1]
+	std::vector< uint32_t > blockers; //proxy ids
+	std::vector< uint64_t > next_touching;
+};
+
+//advance the free-for-all by 'elapsed' seconds; inputs[i] drives paddles[i]
+// (paddles past the end of 'inputs' sit still):
+void step(FreeForAll &ffa, std::vector< PlayerInput > const &inputs, float elapsed);
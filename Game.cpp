@@ -0,0 +1,214 @@
+#include "Game.hpp"
+#include "Balls.hpp"
+#include "SimMath.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <cassert>
+
+GameState::GameState() {
+	paddles[0].position = glm::vec3(-1.2f, 0.0f, 0.16f);
+	paddles[1].position = glm::vec3(1.2f, 0.0f, 0.16f);
+	paddles[1].angle = glm::pi< float >();
+
+	ball.position = glm::vec3(0.0f, 0.0f, 0.2f);
+}
+
+// detect the collision between a spinning stuff and a pillar
+// (spin stuff and pillars both stand on the floor, so only x and y matter)
+bool spin_collide_pillar(Arena const &arena, uint32_t pillar, glm::vec3 const &spin_position) {
+	float dx = spin_position.x - arena.pillar_x[pillar];
+	float dy = spin_position.y - arena.pillar_y[pillar];
+	return dx * dx + dy * dy < arena.pillar_reach2[pillar];
+}
+
+bool spin_collide_pillars(Arena const &arena, glm::vec3 const &spin_position) {
+	//every pillar is tested (no early out), so this is one branch-free loop:
+	bool blocked = false;
+	for (uint32_t p = 0; p < arena.pillar_count(); ++p) {
+		float dx = spin_position.x - arena.pillar_x[p];
+		float dy = spin_position.y - arena.pillar_y[p];
+		blocked |= (dx * dx + dy * dy < arena.pillar_reach2[p]);
+	}
+	return blocked;
+}
+
+// detect the collision between two spinning stuff
+bool spins_collide(glm::vec3 const &spin1_position, glm::vec3 const &spin2_position) {
+	if(distance(spin1_position, spin2_position)<0.55) {
+		return true;
+	}
+	else {
+		return false;
+	}
+}
+
+//ball centre in the spin stuff's frame, and that frame's rotation:
+struct SpinFrame {
+	SpinFrame(glm::vec3 const &spin_position, float angle, glm::vec3 const &ball_position) {
+		sim_sincos(angle, &s, &c);
+		glm::vec3 d = ball_position - spin_position;
+		local = glm::vec3(c * d.x + s * d.y, -s * d.x + c * d.y, d.z);
+	}
+	glm::vec3 to_world(glm::vec3 const &v) const {
+		return glm::vec3(c * v.x - s * v.y, s * v.x + c * v.y, v.z);
+	}
+	float c, s;
+	glm::vec3 local;
+};
+
+//signed distance from a point (in the spin stuff's frame) to the box (negative inside):
+// also returns the outward direction at the closest point
+static float spin_box_distance(glm::vec3 const &local, glm::vec3 *direction) {
+	glm::vec3 closest = glm::clamp(local, SpinBoxMin, SpinBoxMax);
+	glm::vec3 gap = local - closest;
+	float dist2 = glm::dot(gap, gap);
+	if (dist2 > 0.0f) {
+		float dist = std::sqrt(dist2);
+		if (direction) *direction = gap / dist;
+		return dist;
+	}
+	//inside: the way out is through the nearest face
+	float best = local.x - SpinBoxMin.x;
+	glm::vec3 best_direction = glm::vec3(-1.0f, 0.0f, 0.0f);
+	for (uint32_t axis = 0; axis < 3; ++axis) {
+		float to_min = local[axis] - SpinBoxMin[axis];
+		float to_max = SpinBoxMax[axis] - local[axis];
+		if (to_min < best) {
+			best = to_min;
+			best_direction = glm::vec3(0.0f);
+			best_direction[axis] = -1.0f;
+		}
+		if (to_max < best) {
+			best = to_max;
+			best_direction = glm::vec3(0.0f);
+			best_direction[axis] = 1.0f;
+		}
+	}
+	if (direction) *direction = best_direction;
+	return -best;
+}
+
+bool spin_contact_ball(glm::vec3 const &spin_position, float angle, glm::vec3 const &ball_position, SpinContact *contact) {
+	SpinFrame frame(spin_position, angle, ball_position);
+	glm::vec3 direction;
+	float dist = spin_box_distance(frame.local, &direction);
+	if (dist > BallRadius) return false;
+	if (contact) {
+		contact->normal = frame.to_world(direction);
+		contact->depth = BallRadius - dist;
+	}
+	return true;
+}
+
+// detect the collision between the spin stuff and the ball
+bool spin_collide_ball(GameState::Paddle const &spin, glm::vec3 const &ball_position) {
+	return spin_contact_ball(spin.position, spin.angle, ball_position);
+}
+
+bool spin_sweep_ball(glm::vec3 const &spin_start, glm::vec3 const &spin_end, float angle_start, float spin_rate, glm::vec3 const &ball_position, glm::vec3 const &ball_velocity, float elapsed, float *toi) {
+	assert(toi);
+	if (elapsed <= 0.0f) return false;
+	glm::vec3 spin_velocity = (spin_end - spin_start) / elapsed;
+	//conservative advancement: no point of the box approaches the ball faster than this,
+	//so stepping forward by (distance / max_approach) can never skip over a contact:
+	float max_approach = glm::length(ball_velocity - spin_velocity) + std::abs(spin_rate) * SpinReach;
+	float t = 0.0f;
+	for (uint32_t iter = 0; iter < 32; ++iter) {
+		SpinFrame frame(spin_start + t * spin_velocity, angle_start + t * spin_rate, ball_position + t * ball_velocity);
+		float d = spin_box_distance(frame.local, nullptr) - BallRadius;
+		if (d <= 1e-4f) {
+			*toi = t;
+			return true;
+		}
+		if (max_approach == 0.0f) return false;
+		t += d / max_approach;
+		if (t > elapsed) return false;
+	}
+	//(only grazing contacts take this many iterations; treat them as misses)
+	return false;
+}
+
+//move one player's spinning stuff, backing off if it runs into a pillar or the other one:
+static void move_paddle(Arena const &arena, GameState &state, uint32_t index, PlayerInput const &input, float elapsed) {
+	GameState::Paddle &paddle = state.paddles[index];
+	auto blocked = [&arena, &state, &paddle]() {
+		return spin_collide_pillars(arena, paddle.position) || spins_collide(state.paddles[0].position, state.paddles[1].position);
+	};
+	move_spin(arena, paddle, input, elapsed, blocked);
+	toggle_spin(paddle, input);
+}
+
+void toggle_spin(GameState::Paddle &paddle, PlayerInput const &input) {
+	// handle changing the direction of the spinning
+	if(input.toggle) {
+		if(!paddle.changing) {
+			paddle.clockwise *= -1.0f;
+		}
+		paddle.changing = true;
+	} else {
+		paddle.changing = false;
+	}
+}
+
+void turn_spin(GameState::Paddle &paddle, float elapsed, SpinMotion *spin) {
+	assert(spin);
+	spin->end = paddle.position;
+	spin->angle_start = paddle.angle;
+	spin->spin_rate = 5.0f * paddle.clockwise;
+
+	// update rotation
+	paddle.angle += 5.0f * paddle.clockwise * elapsed;
+	if(paddle.angle > glm::two_pi< float >()) {
+		paddle.angle -= glm::two_pi< float >();
+	} else if(paddle.angle < -glm::two_pi< float >()) {
+		paddle.angle += glm::two_pi< float >();
+	}
+	// update normal: the arm, (-1,0,0) turned by the angle -- normalized as a point (w = 1
+	//  included), as it always has been, so a hit pushes at 1/sqrt(2) of hit_impulse
+	float s, c;
+	sim_sincos(paddle.angle, &s, &c);
+	float scale = 1.0f / std::sqrt(c * c + s * s + 1.0f);
+	paddle.normal = -1.0f * paddle.clockwise * scale * glm::vec3(-c, -s, 0.0f);
+	spin->normal = paddle.normal;
+}
+
+uint32_t state_hash(GameState const &state) {
+	StateHash sum;
+	for (auto const &paddle : state.paddles) {
+		sum.add(paddle.position);
+		sum.add(paddle.angle);
+		sum.add(paddle.clockwise);
+		sum.add(uint32_t(paddle.changing));
+		sum.add(paddle.normal);
+	}
+	sum.add(state.ball.position);
+	sum.add(state.ball.velocity);
+	sum.add(uint32_t(state.ball.hit));
+	sum.add(uint32_t(state.winner));
+	return sum.finish();
+}
+
+void step_spins(Arena const &arena, GameState &state, GameInputs const &inputs, float elapsed, SpinMotion (&spins)[2]) {
+	for(uint32_t i = 0; i < 2; i++) {
+		spins[i].start = state.paddles[i].position;
+	}
+
+	//spin stuff
+	// right player
+	move_paddle(arena, state, 0, inputs.players[0], elapsed);
+	// left player
+	move_paddle(arena, state, 1, inputs.players[1], elapsed);
+
+	for(uint32_t i = 0; i < 2; i++) {
+		turn_spin(state.paddles[i], elapsed, &spins[i]);
+	}
+}
+
+void step(Arena const &arena, GameState &state, GameInputs const &inputs, float elapsed) {
+	SpinMotion spins[2];
+	step_spins(arena, state, inputs, elapsed, spins);
+	//the ball rules live in Balls.cpp, shared with multi-ball mode:
+	step_balls(arena, spins, 2, ball_arrays(state.ball), elapsed, &state.winner);
+}
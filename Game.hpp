@@ -0,0 +1,188 @@
+#pragma once
+
+#include "Arena.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+//"Game" holds the rules of Spin as plain data.
+// Nothing here touches SDL or OpenGL, so servers, bots, and benchmarks can
+// link it without a window; main.cpp just copies the state into the Scene.
+
+//Controls for one player for one update:
+// (keys are named as the right player sees them -- the left player's
+//  'D' is "right", 'A' is "left", 'W' is "up", 'S' is "down", 'Q' is "toggle")
+struct PlayerInput {
+	bool left = false;
+	bool right = false;
+	bool up = false;
+	bool down = false;
+	bool toggle = false; //flips spin direction (once per press)
+};
+
+struct GameInputs {
+	PlayerInput players[2];
+};
+
+struct GameState {
+	GameState(); //sets up the start-of-match positions
+
+	struct Paddle {
+		glm::vec3 position = glm::vec3(0.0f);
+		float angle = 0.0f; //rotation about z, in radians
+		float clockwise = -1.0f; //spin direction, +1 or -1
+		bool changing = false; //toggle was held last update
+		glm::vec3 normal = glm::vec3(0.0f); //direction the ball is pushed when hit
+	};
+	struct Ball {
+		glm::vec3 position = glm::vec3(0.0f);
+		glm::vec3 velocity = glm::vec3(0.0f);
+		uint8_t hit = 0; //bit i set: was touching paddles[i] last update
+	};
+
+	//paddles[0] is the right player (arrow keys + '/'),
+	//paddles[1] is the left player (WASD + 'Q'):
+	Paddle paddles[2];
+	Ball ball;
+
+	//index of the player who scored, or -1 while the match is still going:
+	int32_t winner = -1;
+};
+
+//GameState is one block of plain data (no pointers, containers, or anything the
+// Scene owns), so a snapshot is a memcpy and so is restoring one -- cheap enough
+// to keep one per tick for rollback or rewind, or to copy per node in a search
+// (see "bench snapshot"). Keep it that way: anything added here must be plain data too.
+static_assert(std::is_trivially_copyable< GameState >::value, "GameState should be copyable with memcpy");
+
+//advance the game by 'elapsed' seconds in 'arena':
+// (rules are meant to be stepped at a fixed rate -- main.cpp accumulates
+//  frame time and calls step(..., TickElapsed) as many times as needed)
+void step(Arena const &arena, GameState &state, GameInputs const &inputs, float elapsed);
+
+const float TickElapsed = 1.0f / 240.0f;
+
+//Hashes of the state, for catching a desync (between rollback peers, or a replay played
+// back on another machine) on the tick it happens. The rules are bit-for-bit deterministic
+// (see SimMath.hpp), so equal states hash equal everywhere. Words are mixed in Murmur3-style
+// -- floats by their bits, field by field, so padding doesn't matter:
+struct StateHash {
+	uint32_t hash = 0x5b1d5eedU;
+	void add(uint32_t word) {
+		word *= 0xcc9e2d51U;
+		word = (word << 15) | (word >> 17);
+		word *= 0x1b873593U;
+		hash ^= word;
+		hash = (hash << 13) | (hash >> 19);
+		hash = hash * 5 + 0xe6546b64U;
+	}
+	void add(float value) {
+		uint32_t word;
+		std::memcpy(&word, &value, sizeof(word));
+		add(word);
+	}
+	void add(glm::vec3 const &v) { add(v.x); add(v.y); add(v.z); }
+	uint32_t finish() const { //(Murmur3's final mix)
+		uint32_t h = hash;
+		h ^= h >> 16; h *= 0x85ebca6bU;
+		h ^= h >> 13; h *= 0xc2b2ae35U;
+		h ^= h >> 16;
+		return h;
+	}
+};
+
+//hash of every field of 'state':
+uint32_t state_hash(GameState const &state);
+//running hash of a match: rolling = roll_hash(rolling, state_hash(state)) once per tick,
+// so comparing the latest one compares every tick so far:
+inline uint32_t roll_hash(uint32_t rolling, uint32_t hash) {
+	StateHash sum;
+	sum.add(rolling);
+	sum.add(hash);
+	return sum.finish();
+}
+
+//How one spin stuff moved during an update (all the ball rules need to know about it):
+struct SpinMotion {
+	glm::vec3 start = glm::vec3(0.0f); //position at the start of the update
+	glm::vec3 end = glm::vec3(0.0f); //position at the end of the update
+	float angle_start = 0.0f;
+	float spin_rate = 0.0f; //radians per second
+	glm::vec3 normal = glm::vec3(0.0f); //direction a hit pushes the ball
+};
+
+//first half of step(): move and spin both spin stuff, reporting how they moved:
+void step_spins(Arena const &arena, GameState &state, GameInputs const &inputs, float elapsed, SpinMotion (&spins)[2]);
+
+//pieces of step_spins for rules with other numbers of spin stuff (see FreeForAll.hpp):
+//how close a spin stuff's pivot may get to the goal lines (x) and side walls (y), about (0.15, 0.12):
+// written as the original field's half size less its old limits, so that on that field
+// half_size - SpinMargin comes out at exactly (2.95f, 1.4f), as the limits always were
+// (0.15f itself would give 2.94999981f):
+const glm::vec2 SpinMargin = glm::vec2(3.1f - 2.95f, 1.52f - 1.4f);
+//move for one update as 'input' says, staying SpinMargin inside the arena's walls and
+// taking back any step after which 'blocked()' says it ran into something:
+template< typename Blocked >
+void move_spin(Arena const &arena, GameState::Paddle &paddle, PlayerInput const &input, float elapsed, Blocked const &blocked) {
+	glm::vec2 limit = arena.half_size - SpinMargin;
+	float move = arena.tuning.paddle_speed * elapsed;
+
+	if (input.right) {
+		if (paddle.position.x >= -limit.x) {
+			paddle.position.x -= move;
+			if (blocked()) paddle.position.x += move;
+		}
+	} else if (input.left) {
+		if (paddle.position.x <= limit.x) {
+			paddle.position.x += move;
+			if (blocked()) paddle.position.x -= move;
+		}
+	}
+	if (input.up) {
+		if (paddle.position.y >= -limit.y) {
+			paddle.position.y -= move;
+			if (blocked()) paddle.position.y += move;
+		}
+	} else if (input.down) {
+		if (paddle.position.y <= limit.y) {
+			paddle.position.y += move;
+			if (blocked()) paddle.position.y -= move;
+		}
+	}
+}
+//flip the spin direction when toggle is first pressed:
+void toggle_spin(GameState::Paddle &paddle, PlayerInput const &input);
+//spin for one update (after moving); fills in everything in *spin but 'start':
+void turn_spin(GameState::Paddle &paddle, float elapsed, SpinMotion *spin);
+
+//Collision shapes, measured from the meshes (Spin is drawn at scale 0.05, Ball at 0.08).
+// The spin stuff is a box in its own frame (pivot at the origin, blade along -y):
+const glm::vec3 SpinBoxMin = glm::vec3(-0.05f, -0.273f, -0.05f);
+const glm::vec3 SpinBoxMax = glm::vec3( 0.05f,  0.05f,  0.273f);
+//farthest any part of that box gets from the pivot's vertical axis:
+const float SpinReach = 0.2776f;
+const float BallRadius = 0.08f;
+
+struct SpinContact {
+	glm::vec3 normal = glm::vec3(0.0f); //unit vector, from the spin stuff toward the ball
+	float depth = 0.0f; //how far the ball overlaps the spin stuff
+};
+
+//collision tests used by step() (exposed for tools that want to query them):
+bool spin_collide_pillar(Arena const &arena, uint32_t pillar, glm::vec3 const &spin_position);
+bool spin_collide_pillars(Arena const &arena, glm::vec3 const &spin_position); //any pillar
+bool spins_collide(glm::vec3 const &spin1_position, glm::vec3 const &spin2_position);
+
+//exact test of the spin stuff's box (pivot at 'spin_position', turned by 'angle')
+// against the ball's sphere; fills in *contact (if given) when they touch:
+bool spin_contact_ball(glm::vec3 const &spin_position, float angle, glm::vec3 const &ball_position, SpinContact *contact = nullptr);
+bool spin_collide_ball(GameState::Paddle const &spin, glm::vec3 const &ball_position);
+
+//swept version of spin_collide_ball over one update: the spin stuff moves from
+// spin_start to spin_end while turning from angle_start at spin_rate (radians/sec)
+// and the ball moves at ball_velocity; returns true (and the time of first
+// contact, in [0, elapsed], in *toi) if they touch at any point:
+bool spin_sweep_ball(glm::vec3 const &spin_start, glm::vec3 const &spin_end, float angle_start, float spin_rate, glm::vec3 const &ball_position, glm::vec3 const &ball_velocity, float elapsed, float *toi);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+
+//Fixed-width histogram of durations, for the latency percentiles the network tools report:
+struct Histogram {
+	explicit Histogram(double bucket_seconds_ = 10e-6, uint32_t buckets = 1000)
+		: bucket_seconds(bucket_seconds_), counts(buckets + 1, 0) { } //(the extra bucket catches everything longer)
+
+	double bucket_seconds;
+	std::vector< uint64_t > counts;
+	uint64_t total = 0;
+	double worst = 0.0;
+
+	void add(double seconds) {
+		uint32_t bucket = uint32_t(std::max(0.0, seconds) / bucket_seconds);
+		counts[std::min< uint32_t >(bucket, uint32_t(counts.size()) - 1)] += 1;
+		total += 1;
+		worst = std::max(worst, seconds);
+	}
+	void add(Histogram const &other) {
+		for (uint32_t i = 0; i < counts.size() && i < other.counts.size(); ++i) counts[i] += other.counts[i];
+		total += other.total;
+		worst = std::max(worst, other.worst);
+	}
+
+	//duration (in seconds, to the bucket) that fraction 'f' of samples were no longer than:
+	double percentile(double f) const {
+		uint64_t want = uint64_t(f * total);
+		uint64_t seen = 0;
+		for (uint32_t i = 0; i < counts.size(); ++i) {
+			seen += counts[i];
+			if (seen > want) return (i + 1) * bucket_seconds;
+		}
+		return counts.size() * bucket_seconds;
+	}
+};
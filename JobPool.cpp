@@ -0,0 +1,113 @@
+#include "JobPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+//which pool and worker the current thread belongs to (if any):
+static thread_local JobPool const *current_pool = nullptr;
+static thread_local uint32_t current_worker = 0;
+
+JobPool::JobPool(uint32_t threads) : pending(0), queued(0), next_worker(0), steal_count(0) {
+	if (threads == 0) threads = std::max(1U, std::thread::hardware_concurrency());
+	for (uint32_t i = 0; i < threads; ++i) {
+		workers.emplace_back(new Worker);
+	}
+	//(threads start after every queue exists, since they steal from each other)
+	for (uint32_t i = 0; i < threads; ++i) {
+		workers[i]->thread = std::thread(&JobPool::work, this, i);
+	}
+}
+
+JobPool::~JobPool() {
+	wait();
+	{
+		std::unique_lock< std::mutex > idle(idle_lock);
+		quit = true;
+	}
+	work_ready.notify_all();
+	for (auto &worker : workers) {
+		worker->thread.join();
+	}
+}
+
+void JobPool::submit(std::function< void() > const &job) {
+	uint32_t target;
+	if (current_pool == this) {
+		target = current_worker;
+	} else {
+		target = next_worker.fetch_add(1) % size();
+	}
+	pending.fetch_add(1);
+	{
+		std::unique_lock< std::mutex > lock(workers[target]->lock);
+		workers[target]->jobs.emplace_back(job);
+	}
+	{
+		//(queued changes under idle_lock so sleeping workers can't miss it)
+		std::unique_lock< std::mutex > idle(idle_lock);
+		queued.fetch_add(1);
+	}
+	work_ready.notify_one();
+}
+
+bool JobPool::run_one(uint32_t self) {
+	std::function< void() > job;
+	bool found = false;
+	{ //newest job from our own queue:
+		Worker &worker = *workers[self];
+		std::unique_lock< std::mutex > lock(worker.lock);
+		if (!worker.jobs.empty()) {
+			job = std::move(worker.jobs.back());
+			worker.jobs.pop_back();
+			found = true;
+		}
+	}
+	for (uint32_t i = 1; !found && i <= size(); ++i) { //oldest job from someone else's:
+		uint32_t other = (self + i) % size();
+		if (other == self) continue;
+		Worker &victim = *workers[other];
+		std::unique_lock< std::mutex > lock(victim.lock);
+		if (!victim.jobs.empty()) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			found = true;
+			steal_count.fetch_add(1);
+		}
+	}
+	if (!found) return false;
+	queued.fetch_sub(1);
+
+	job();
+
+	if (pending.fetch_sub(1) == 1) {
+		std::unique_lock< std::mutex > idle(idle_lock);
+		all_done.notify_all();
+	}
+	return true;
+}
+
+void JobPool::work(uint32_t self) {
+	current_pool = this;
+	current_worker = self;
+	while (true) {
+		if (run_one(self)) continue;
+		std::unique_lock< std::mutex > idle(idle_lock);
+		work_ready.wait(idle, [this]() { return quit || queued.load() > 0; });
+		if (quit && queued.load() == 0) return;
+	}
+}
+
+void JobPool::wait() {
+	assert(current_pool != this && "a job waiting for all jobs would be waiting for itself");
+	std::unique_lock< std::mutex > idle(idle_lock);
+	all_done.wait(idle, [this]() { return pending.load() == 0; });
+}
+
+void JobPool::parallel_for(uint32_t count, uint32_t grain, std::function< void(uint32_t, uint32_t) > const &body) {
+	assert(grain > 0);
+	for (uint32_t begin = 0; begin < count; begin += grain) {
+		uint32_t end = std::min(count, begin + grain);
+		submit([&body, begin, end]() { body(begin, end); });
+	}
+	wait();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+//A fixed set of worker threads with work stealing:
+// every worker has its own queue of jobs; it runs the newest job in its own
+// queue (so related work stays on one core), and when that runs dry it
+// steals the oldest job from another worker. Jobs submitted from inside a
+// job go on the submitting worker's queue; jobs submitted from outside are
+// dealt out round-robin.
+
+struct JobPool {
+	explicit JobPool(uint32_t threads = 0); //0 means one per core
+	~JobPool();
+
+	JobPool(JobPool const &) = delete;
+	JobPool &operator=(JobPool const &) = delete;
+
+	void submit(std::function< void() > const &job);
+
+	//block until every submitted job has finished (don't call this from a job):
+	void wait();
+
+	//split [0, count) into pieces of (at most) 'grain' and run body(begin, end) on each, then wait:
+	void parallel_for(uint32_t count, uint32_t grain, std::function< void(uint32_t, uint32_t) > const &body);
+
+	uint32_t size() const { return uint32_t(workers.size()); }
+
+	//how many jobs were taken from another worker's queue so far:
+	uint64_t steals() const { return steal_count.load(); }
+
+private:
+	struct Worker {
+		std::mutex lock;
+		std::deque< std::function< void() > > jobs;
+		std::thread thread;
+	};
+	std::vector< std::unique_ptr< Worker > > workers;
+
+	//count of submitted-but-unfinished jobs (guarded by 'idle_lock' for sleeping/waking):
+	std::atomic< uint64_t > pending;
+	std::atomic< uint64_t > queued; //jobs sitting in some queue
+	std::atomic< uint32_t > next_worker;
+	std::atomic< uint64_t > steal_count;
+	bool quit = false;
+	std::mutex idle_lock;
+	std::condition_variable work_ready;
+	std::condition_variable all_done;
+
+	bool run_one(uint32_t self); //run one job on worker 'self' (own queue first, then steal); false if none
+	void work(uint32_t self);
+};
@@ -0,0 +1,295 @@
+#include "Net.hpp"
+#include "Replay.hpp" //for pack_inputs
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cassert>
+
+//---------------------------
+
+UdpSocket::UdpSocket(uint16_t port, std::string const &peer) : mt(std::random_device()()), created(std::chrono::steady_clock::now()) {
+	#ifdef _WIN32
+	WSADATA wsa_data;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) throw std::runtime_error("Failed to start winsock");
+	#endif
+
+	auto colon = peer.rfind(':');
+	if (colon == std::string::npos) throw std::runtime_error("Peer address '" + peer + "' should be host:port");
+	std::string host = peer.substr(0, colon);
+	std::string service = peer.substr(colon + 1);
+
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo *found = nullptr;
+	if (getaddrinfo(host.c_str(), service.c_str(), &hints, &found) != 0 || !found) {
+		throw std::runtime_error("Failed to look up peer address '" + peer + "'");
+	}
+	uint8_t const *address = reinterpret_cast< uint8_t const * >(found->ai_addr);
+	peer_address.assign(address, address + found->ai_addrlen);
+	freeaddrinfo(found);
+
+	handle = intptr_t(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+	#ifdef _WIN32
+	if (SOCKET(handle) == INVALID_SOCKET) throw std::runtime_error("Failed to create socket");
+	u_long non_blocking = 1;
+	ioctlsocket(SOCKET(handle), FIONBIO, &non_blocking);
+	#else
+	if (handle < 0) throw std::runtime_error("Failed to create socket");
+	fcntl(int(handle), F_SETFL, fcntl(int(handle), F_GETFL, 0) | O_NONBLOCK);
+	#endif
+
+	sockaddr_in local;
+	std::memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(port);
+	if (bind(handle, reinterpret_cast< sockaddr const * >(&local), sizeof(local)) != 0) {
+		#ifdef _WIN32
+		closesocket(SOCKET(handle));
+		#else
+		close(int(handle));
+		#endif
+		throw std::runtime_error("Failed to bind UDP port " + std::to_string(port));
+	}
+}
+
+UdpSocket::~UdpSocket() {
+	#ifdef _WIN32
+	closesocket(SOCKET(handle));
+	WSACleanup();
+	#else
+	close(int(handle));
+	#endif
+}
+
+void UdpSocket::send(std::vector< uint8_t > const &packet) {
+	sent += 1;
+	if (conditions.outage_length > 0.0f) {
+		float age = std::chrono::duration< float >(std::chrono::steady_clock::now() - created).count();
+		if (age >= conditions.outage_start && age < conditions.outage_start + conditions.outage_length) {
+			dropped += 1;
+			return;
+		}
+	}
+	if (conditions.loss > 0.0f && std::uniform_real_distribution< float >(0.0f, 1.0f)(mt) < conditions.loss) {
+		dropped += 1;
+		return;
+	}
+	if (conditions.latency <= 0.0f && conditions.jitter <= 0.0f) {
+		send_now(packet);
+		return;
+	}
+	float delay = conditions.latency + std::uniform_real_distribution< float >(0.0f, conditions.jitter)(mt);
+	held.emplace_back();
+	held.back().due = std::chrono::steady_clock::now() + std::chrono::duration_cast< std::chrono::steady_clock::duration >(std::chrono::duration< float >(delay));
+	held.back().packet = packet;
+}
+
+void UdpSocket::pump() {
+	auto now = std::chrono::steady_clock::now();
+	//(held packets are few, so a scan is fine)
+	for (uint32_t i = 0; i < held.size(); /* later */) {
+		if (held[i].due <= now) {
+			send_now(held[i].packet);
+			held.erase(held.begin() + i);
+		} else {
+			++i;
+		}
+	}
+}
+
+void UdpSocket::send_now(std::vector< uint8_t > const &packet) {
+	//(a full send buffer just drops the packet, as the network might have)
+	sendto(handle, reinterpret_cast< char const * >(packet.data()), int(packet.size()), 0,
+		reinterpret_cast< sockaddr const * >(peer_address.data()), socklen_t(peer_address.size()));
+}
+
+bool UdpSocket::receive(std::vector< uint8_t > *packet) {
+	assert(packet);
+	while (true) {
+		packet->resize(1500);
+		sockaddr_storage from;
+		socklen_t from_size = sizeof(from);
+		auto got = recvfrom(handle, reinterpret_cast< char * >(packet->data()), int(packet->size()), 0,
+			reinterpret_cast< sockaddr * >(&from), &from_size);
+		if (got < 0) return false; //(nothing waiting -- or an error, which the next call will see too)
+		//only listen to the peer:
+		sockaddr_in const &in = *reinterpret_cast< sockaddr_in const * >(&from);
+		sockaddr_in const &want = *reinterpret_cast< sockaddr_in const * >(peer_address.data());
+		if (in.sin_port != want.sin_port) continue;
+		packet->resize(size_t(got));
+		return true;
+	}
+}
+
+//---------------------------
+
+//What the two sessions send each other, once a frame:
+struct InputPacketHeader {
+	char magic[4] = {'n', 'e', 't', '0'};
+	uint32_t tick = 0; //sender's current tick
+	uint32_t ack = 0; //sender has the receiver's inputs for every tick before this
+	uint32_t first = 0; //tick of the first input below
+	uint32_t checked = -1U; //tick whose final state 'checksum' is (-1U for none)
+	uint32_t checksum = 0;
+	int32_t advantage = 0; //sender's tick minus the newest tick it has heard the receiver is on
+	uint8_t count = 0; //inputs (one byte each, from pack_inputs) after the header
+	uint8_t input_delay = 0;
+	uint8_t player = 0; //the sender's local player
+	uint8_t padding = 0;
+};
+static_assert(sizeof(InputPacketHeader) == 32, "Input packet header should be packed");
+
+NetSession::NetSession(Arena const &arena, uint32_t local_player, uint32_t input_delay, UdpSocket &socket_)
+	: rollback(arena, local_player, input_delay), socket(socket_) {
+}
+
+constexpr uint32_t NetSession::MaxTicksPerFrame;
+
+uint32_t NetSession::update(PlayerInput const &local, float elapsed) {
+	poll();
+
+	if (!connected) { //(both ends start their clocks when they first hear each other)
+		send();
+		return 0;
+	}
+	accumulator += elapsed;
+
+	//if we're further ahead of the peer than it is of us, we're the faster one; wait a tick:
+	// (latency adds to both advantages alike, so the difference is just twice the clock gap)
+	int32_t advantage = int32_t(rollback.tick) - int32_t(remote_tick);
+	if ((advantage - remote_advantage) / 2 >= 1 && accumulator >= TickElapsed) {
+		accumulator -= TickElapsed;
+		stats.sync_waits += 1;
+	}
+
+	uint32_t ticks = 0;
+	while (accumulator >= TickElapsed && ticks < MaxTicksPerFrame) {
+		if (rollback.tick >= stop_at) {
+			accumulator = 0.0f;
+			break;
+		}
+		if (!rollback.can_advance()) {
+			stats.prediction_stalls += 1;
+			break;
+		}
+		//(every unacknowledged input goes in each packet, so don't make more than one packet -- and history -- can hold)
+		if (rollback.local_end() >= remote_ack + Rollback::MaxPrediction) {
+			stats.ack_stalls += 1;
+			break;
+		}
+		rollback.advance(local);
+		accumulator -= TickElapsed;
+		ticks += 1;
+	}
+	//(never bank more time than can be caught up on in a few frames)
+	accumulator = std::min(accumulator, 4 * MaxTicksPerFrame * TickElapsed);
+
+	send();
+	return ticks;
+}
+
+void NetSession::exchange() {
+	poll();
+	send();
+}
+
+void NetSession::poll() {
+	stats.frames += 1;
+	socket.pump();
+	receive();
+
+	auto start = std::chrono::high_resolution_clock::now();
+	uint32_t resimulated = rollback.correct();
+	if (resimulated) {
+		double seconds = std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - start).count();
+		stats.rollbacks += 1;
+		stats.resimulated += resimulated;
+		stats.most_resimulated = std::max(stats.most_resimulated, resimulated);
+		stats.resimulate_seconds += seconds;
+		stats.most_resimulate_seconds = std::max(stats.most_resimulate_seconds, seconds);
+	}
+
+	//compare the peer's final state with ours, once ours is final too:
+	uint32_t checksum = 0;
+	if (remote_check.tick != -1U && rollback.final_checksum(remote_check.tick, &checksum)) {
+		if (checksum == remote_check.checksum) stats.checks += 1;
+		else stats.desyncs += 1;
+		remote_check.tick = -1U;
+	}
+}
+
+void NetSession::receive() {
+	std::vector< uint8_t > packet;
+	while (socket.receive(&packet)) {
+		InputPacketHeader header;
+		if (packet.size() < sizeof(header)) continue;
+		std::memcpy(&header, packet.data(), sizeof(header));
+		if (std::string(header.magic, 4) != "net0") continue;
+		if (packet.size() != sizeof(header) + header.count) continue;
+		if (header.player == rollback.local_player) {
+			throw std::runtime_error("Peer is playing as the same player as us");
+		}
+		if (header.input_delay != rollback.input_delay) {
+			throw std::runtime_error("Peer uses a different input delay (" + std::to_string(header.input_delay) + " ticks)");
+		}
+
+		connected = true;
+		stats.packets_received += 1;
+		if (header.tick >= remote_tick) { //(packets may arrive out of order)
+			remote_tick = header.tick;
+			remote_advantage = header.advantage;
+		}
+		remote_ack = std::max(remote_ack, header.ack);
+		for (uint32_t i = 0; i < header.count; ++i) {
+			rollback.receive_remote(header.first + i, unpack_inputs(packet[sizeof(header) + i]).players[0]);
+		}
+		if (header.checked != -1U && (remote_check.tick == -1U || header.checked > remote_check.tick)) {
+			remote_check.tick = header.checked;
+			remote_check.checksum = header.checksum;
+		}
+	}
+}
+
+void NetSession::send() {
+	InputPacketHeader header;
+	header.tick = rollback.tick;
+	header.ack = rollback.remote_confirmed;
+	header.advantage = int32_t(rollback.tick) - int32_t(remote_tick);
+	header.input_delay = uint8_t(rollback.input_delay);
+	header.player = uint8_t(rollback.local_player);
+
+	//every input the peer hasn't acknowledged (so lost packets don't matter; update() keeps these to MaxPrediction):
+	uint32_t end = rollback.local_end();
+	header.first = std::min(end, remote_ack);
+	assert(end - header.first <= Rollback::MaxPrediction);
+	header.count = uint8_t(end - header.first);
+
+	uint32_t at = std::min(rollback.remote_confirmed, rollback.tick);
+	if (rollback.final_checksum(at, &header.checksum)) header.checked = at;
+
+	std::vector< uint8_t > packet(sizeof(header) + header.count);
+	std::memcpy(packet.data(), &header, sizeof(header));
+	for (uint32_t i = 0; i < header.count; ++i) {
+		GameInputs inputs;
+		inputs.players[0] = rollback.local_input(header.first + i);
+		packet[sizeof(header) + i] = uint8_t(pack_inputs(inputs));
+	}
+	socket.send(packet);
+}
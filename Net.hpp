@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Rollback.hpp"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//Playing a match over UDP: a non-blocking socket talking to one peer, and a
+// session that runs a Rollback and trades inputs with the peer's session.
+// Both ends run the same code; which player is local is the only difference.
+
+//Faults to inject into outgoing packets, for testing over loopback:
+struct LinkConditions {
+	float latency = 0.0f; //seconds each packet is held before sending
+	float jitter = 0.0f; //plus up to this much more (so packets can arrive out of order)
+	float loss = 0.0f; //fraction of packets dropped
+	float outage_start = 0.0f; //drop every packet for 'outage_length' seconds, starting this long after the socket is made
+	float outage_length = 0.0f; // (set on one end only for a one-way outage)
+};
+
+struct UdpSocket {
+	//bind to 'port' on every interface and send to 'peer' ("host:port"); throws on failure:
+	UdpSocket(uint16_t port, std::string const &peer);
+	~UdpSocket();
+
+	UdpSocket(UdpSocket const &) = delete;
+	UdpSocket &operator=(UdpSocket const &) = delete;
+
+	LinkConditions conditions;
+
+	//queue a packet (goes out now, or in pump() if 'conditions' says to hold it):
+	void send(std::vector< uint8_t > const &packet);
+	//send any held packets that are due:
+	void pump();
+	//next packet from the peer, if one is waiting (never blocks):
+	bool receive(std::vector< uint8_t > *packet);
+
+	uint64_t sent = 0; //packets handed to send()
+	uint64_t dropped = 0; //of those, how many 'conditions' threw away
+
+private:
+	intptr_t handle; //(a SOCKET on windows, an fd elsewhere)
+	std::vector< uint8_t > peer_address; //(a sockaddr)
+	struct Held {
+		std::chrono::steady_clock::time_point due;
+		std::vector< uint8_t > packet;
+	};
+	std::vector< Held > held;
+	std::mt19937 mt;
+	std::chrono::steady_clock::time_point created;
+	void send_now(std::vector< uint8_t > const &packet);
+};
+
+//One end of a networked match:
+struct NetSession {
+	NetSession(Arena const &arena, uint32_t local_player, uint32_t input_delay, UdpSocket &socket);
+
+	Rollback rollback;
+	UdpSocket &socket;
+
+	//most ticks one frame may run (how quickly a peer that fell behind catches up):
+	static constexpr uint32_t MaxTicksPerFrame = 8;
+
+	//call once a frame: reads packets, fixes mispredictions, runs however many ticks
+	// 'elapsed' seconds are worth (more when catching up, fewer when ahead of the peer),
+	// and sends our inputs; returns the number of new ticks run:
+	uint32_t update(PlayerInput const &local, float elapsed);
+	//like update(), but without running any new ticks (for waiting at the end of a match):
+	void exchange();
+
+	bool connected = false; //heard from the peer yet?
+	uint32_t stop_at = -1U; //don't run ticks past this one
+
+	//what it has cost so far:
+	struct Stats {
+		uint64_t frames = 0;
+		uint64_t rollbacks = 0; //frames that re-simulated anything
+		uint64_t resimulated = 0; //ticks re-simulated in all
+		uint32_t most_resimulated = 0; //in one frame
+		double resimulate_seconds = 0.0;
+		double most_resimulate_seconds = 0.0; //in one frame
+		uint64_t prediction_stalls = 0; //frames cut short because the peer's inputs were too far behind
+		uint64_t ack_stalls = 0; //frames cut short because the peer hadn't acknowledged enough of our inputs
+		uint64_t sync_waits = 0; //ticks not run to let a slower peer catch up
+		uint64_t packets_received = 0;
+		uint64_t desyncs = 0; //final-state checksums that didn't match the peer's
+		uint64_t checks = 0; //ones that did
+	} stats;
+
+	//peer's view, from its latest packet:
+	uint32_t remote_tick = 0;
+	uint32_t remote_ack = 0; //peer has our inputs for every tick before this
+	int32_t remote_advantage = 0;
+
+private:
+	float accumulator = 0.0f;
+	struct { uint32_t tick = -1U; uint32_t checksum = 0; } remote_check; //peer's final checksum not yet compared
+	void poll(); //receive, correct, and compare checksums
+	void receive();
+	void send();
+};
@@ -0,0 +1,362 @@
+#include "Replay.hpp"
+#include "BallGrid.hpp"
+#include "read_chunk.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <cassert>
+
+uint16_t pack_inputs(GameInputs const &inputs) {
+	uint16_t bits = 0;
+	for (uint32_t p = 0; p < 2; ++p) {
+		PlayerInput const &player = inputs.players[p];
+		uint16_t five = (player.left ? 1 : 0)
+			| (player.right ? 2 : 0)
+			| (player.up ? 4 : 0)
+			| (player.down ? 8 : 0)
+			| (player.toggle ? 16 : 0);
+		bits |= five << (5 * p);
+	}
+	return bits;
+}
+
+GameInputs unpack_inputs(uint16_t bits) {
+	GameInputs inputs;
+	for (uint32_t p = 0; p < 2; ++p) {
+		PlayerInput &player = inputs.players[p];
+		uint16_t five = (bits >> (5 * p)) & 31;
+		player.left = (five & 1);
+		player.right = (five & 2);
+		player.up = (five & 4);
+		player.down = (five & 8);
+		player.toggle = (five & 16);
+	}
+	return inputs;
+}
+
+template< typename T >
+static void write_chunk(std::ostream &to, char const (&magic)[5], std::vector< T > const &data) {
+	uint32_t size = uint32_t(data.size() * sizeof(T));
+	to.write(magic, 4);
+	to.write(reinterpret_cast< char const * >(&size), sizeof(size));
+	to.write(reinterpret_cast< char const * >(data.data()), size);
+}
+
+//---------------------------
+
+ReplayWriter::ReplayWriter(std::string const &filename, Arena const &arena, Balls const &balls, uint32_t keyframe_ticks_)
+	: keyframe_ticks(keyframe_ticks_), file(filename, std::ios::binary) {
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "' to record to");
+	if (keyframe_ticks == 0) throw std::runtime_error("Replay keyframes need to be at least a tick apart");
+
+	ReplayHeader header;
+	header.half_size = arena.half_size;
+	header.tuning = arena.tuning;
+	header.keyframe_ticks = keyframe_ticks;
+	file.write(reinterpret_cast< char const * >(&header), sizeof(header));
+
+	std::vector< ReplayPillar > pillars(arena.pillar_count());
+	for (uint32_t p = 0; p < arena.pillar_count(); ++p) {
+		pillars[p].x = arena.pillar_x[p];
+		pillars[p].y = arena.pillar_y[p];
+		pillars[p].z = arena.pillar_z[p];
+		pillars[p].radius2 = arena.pillar_radius2[p];
+		pillars[p].reach2 = arena.pillar_reach2[p];
+	}
+	write_chunk(file, "pil0", pillars);
+
+	std::vector< glm::vec3 > starts;
+	for (uint32_t i = 0; i < balls.size(); ++i) {
+		starts.emplace_back(balls.x[i], balls.y[i], balls.z[i]);
+	}
+	write_chunk(file, "bal0", starts);
+
+	if (!file) throw std::runtime_error("Failed to write to '" + filename + "'");
+
+	run.inputs = 0;
+	run.ticks = 0;
+}
+
+ReplayWriter::~ReplayWriter() {
+	if (run.ticks) write_run();
+
+	ReplayFooter footer;
+	footer.ticks = ticks;
+	footer.index = uint64_t(file.tellp());
+	ReplayRun marker;
+	marker.inputs = ReplayRun::Index;
+	marker.ticks = 0;
+	file.write(reinterpret_cast< char const * >(&marker), sizeof(marker));
+	write_chunk(file, "idx0", index);
+	file.write(reinterpret_cast< char const * >(&footer), sizeof(footer));
+}
+
+void ReplayWriter::record(GameInputs const &inputs, GameState const &state, Balls const &balls) {
+	if (ticks % keyframe_ticks == 0) {
+		//(runs stop at keyframes, so the runs after one start on its tick)
+		if (run.ticks) write_run();
+		write_keyframe(state, balls);
+	}
+	uint16_t bits = pack_inputs(inputs);
+	if (run.ticks && (bits != run.inputs || run.ticks == std::numeric_limits< uint16_t >::max())) {
+		write_run();
+	}
+	if (run.ticks == 0) run.inputs = bits;
+	run.ticks += 1;
+	ticks += 1;
+}
+
+void ReplayWriter::write_run() {
+	assert(run.ticks);
+	file.write(reinterpret_cast< char const * >(&run), sizeof(run));
+	run.ticks = 0;
+}
+
+void ReplayWriter::write_keyframe(GameState const &state, Balls const &balls) {
+	index.emplace_back();
+	index.back().tick = ticks;
+	index.back().offset = uint64_t(file.tellp());
+
+	ReplayRun marker;
+	marker.inputs = ReplayRun::Keyframe;
+	marker.ticks = 0;
+	file.write(reinterpret_cast< char const * >(&marker), sizeof(marker));
+
+	ReplayKeyframe keyframe;
+	keyframe.tick = ticks;
+	for (uint32_t i = 0; i < 2; ++i) {
+		GameState::Paddle const &paddle = state.paddles[i];
+		keyframe.paddles[i].position = paddle.position;
+		keyframe.paddles[i].angle = paddle.angle;
+		keyframe.paddles[i].clockwise = paddle.clockwise;
+		keyframe.paddles[i].changing = (paddle.changing ? 1 : 0);
+		keyframe.paddles[i].normal = paddle.normal;
+	}
+	keyframe.ball_position = state.ball.position;
+	keyframe.ball_velocity = state.ball.velocity;
+	keyframe.ball_hit = state.ball.hit;
+	keyframe.winner = state.winner;
+	keyframe.balls = balls.size();
+	file.write(reinterpret_cast< char const * >(&keyframe), sizeof(keyframe));
+
+	std::vector< ReplayBall > records(balls.size());
+	for (uint32_t i = 0; i < balls.size(); ++i) {
+		records[i].x = balls.x[i];
+		records[i].y = balls.y[i];
+		records[i].z = balls.z[i];
+		records[i].vx = balls.vx[i];
+		records[i].vy = balls.vy[i];
+		records[i].hit = balls.hit[i];
+	}
+	file.write(reinterpret_cast< char const * >(records.data()), records.size() * sizeof(ReplayBall));
+}
+
+//---------------------------
+
+ReplayReader::ReplayReader(std::string const &filename) : file(filename, std::ios::binary) {
+	if (!file) throw std::runtime_error("Failed to open replay '" + filename + "'");
+
+	ReplayHeader header, expected;
+	if (!file.read(reinterpret_cast< char * >(&header), sizeof(header))) {
+		throw std::runtime_error("Failed to read replay header");
+	}
+	if (std::string(header.magic, 4) != std::string(expected.magic, 4)) {
+		throw std::runtime_error("Unexpected magic number in replay");
+	}
+	if (header.version != expected.version) {
+		throw std::runtime_error("Replay is of an unsupported version (" + std::to_string(header.version) + ")");
+	}
+	if (header.tick_elapsed != TickElapsed) {
+		throw std::runtime_error("Replay was recorded at a different tick rate");
+	}
+	if (!(header.half_size.x > 0.0f && header.half_size.y > 0.0f)) {
+		throw std::runtime_error("Replay has an empty field");
+	}
+	if (header.keyframe_ticks == 0) {
+		throw std::runtime_error("Replay has no keyframe spacing");
+	}
+	arena.half_size = header.half_size;
+	arena.tuning = header.tuning;
+	keyframe_ticks = header.keyframe_ticks;
+
+	std::vector< ReplayPillar > pillars;
+	read_chunk(file, "pil0", &pillars);
+	arena.clear_pillars();
+	for (auto const &pillar : pillars) {
+		//(squared sizes are copied as-is, since re-squaring a radius may not round the same way)
+		arena.pillar_x.emplace_back(pillar.x);
+		arena.pillar_y.emplace_back(pillar.y);
+		arena.pillar_z.emplace_back(pillar.z);
+		arena.pillar_radius2.emplace_back(pillar.radius2);
+		arena.pillar_reach2.emplace_back(pillar.reach2);
+	}
+
+	std::vector< glm::vec3 > starts;
+	read_chunk(file, "bal0", &starts);
+	for (auto const &start : starts) {
+		balls.add(start);
+	}
+	runs_start = uint64_t(file.tellg());
+
+	//the seek index is at the end, if the recording was closed properly:
+	file.seekg(0, std::ios::end);
+	uint64_t size = uint64_t(file.tellg());
+	ReplayFooter footer, expected_footer;
+	bool indexed = false;
+	if (size >= runs_start + sizeof(ReplayRun) + sizeof(footer)) {
+		file.seekg(size - sizeof(footer));
+		ReplayRun marker;
+		if (file.read(reinterpret_cast< char * >(&footer), sizeof(footer))
+		 && std::string(footer.magic, 4) == std::string(expected_footer.magic, 4)
+		 && footer.index >= runs_start && footer.index < size
+		 && file.seekg(footer.index)
+		 && file.read(reinterpret_cast< char * >(&marker), sizeof(marker))
+		 && marker.ticks == 0 && marker.inputs == ReplayRun::Index) {
+			read_chunk(file, "idx0", &index);
+			length = footer.ticks;
+			indexed = true;
+		}
+	}
+	file.clear();
+	if (!indexed) scan();
+	for (uint32_t i = 0; i < index.size(); ++i) {
+		if (index[i].tick > length || (i > 0 && index[i].tick <= index[i - 1].tick)) {
+			throw std::runtime_error("Replay has a bad seek index");
+		}
+	}
+
+	file.seekg(runs_start);
+	run.inputs = 0;
+	run.ticks = 0;
+}
+
+void ReplayReader::scan() {
+	index.clear();
+	length = 0;
+	file.seekg(runs_start);
+	ReplayRun record;
+	while (true) {
+		uint64_t offset = uint64_t(file.tellg());
+		if (!read_record(&record)) break;
+		if (record.ticks) {
+			length += record.ticks;
+		} else if (record.inputs == ReplayRun::Keyframe) {
+			ReplayKeyframe keyframe;
+			if (!file.read(reinterpret_cast< char * >(&keyframe), sizeof(keyframe))) break;
+			if (keyframe.tick != length) throw std::runtime_error("Replay has a keyframe out of place");
+			file.seekg(uint64_t(keyframe.balls) * sizeof(ReplayBall), std::ios::cur);
+			index.emplace_back();
+			index.back().tick = keyframe.tick;
+			index.back().offset = offset;
+		} else {
+			break; //(the index marker)
+		}
+	}
+	file.clear();
+}
+
+bool ReplayReader::read_record(ReplayRun *record) {
+	assert(record);
+	//(a partly-written last record means the recording was cut short; play what is there)
+	if (!file.read(reinterpret_cast< char * >(record), sizeof(*record))) return false;
+	if (record->ticks == 0 && record->inputs != ReplayRun::Keyframe && record->inputs != ReplayRun::Index) {
+		throw std::runtime_error("Replay has an empty run");
+	}
+	return true;
+}
+
+void ReplayReader::read_keyframe(ReplayKeyframe *keyframe, std::vector< ReplayBall > *balls_) {
+	assert(keyframe);
+	assert(balls_);
+	if (!file.read(reinterpret_cast< char * >(keyframe), sizeof(*keyframe))) {
+		throw std::runtime_error("Replay keyframe is cut short");
+	}
+	if (keyframe->balls != balls.size()) {
+		throw std::runtime_error("Replay keyframe has a different number of balls");
+	}
+	balls_->resize(keyframe->balls);
+	if (!file.read(reinterpret_cast< char * >(balls_->data()), balls_->size() * sizeof(ReplayBall))) {
+		throw std::runtime_error("Replay keyframe is cut short");
+	}
+}
+
+bool ReplayReader::next(GameInputs *inputs) {
+	assert(inputs);
+	while (run.ticks == 0) {
+		if (!read_record(&run)) {
+			run.ticks = 0;
+			return false;
+		}
+		if (run.ticks) break;
+		if (run.inputs == ReplayRun::Keyframe) {
+			//(only needed when seeking)
+			ReplayKeyframe keyframe;
+			if (!file.read(reinterpret_cast< char * >(&keyframe), sizeof(keyframe))) return false;
+			file.seekg(uint64_t(keyframe.balls) * sizeof(ReplayBall), std::ios::cur);
+		} else {
+			//the index follows the last run; stay at the end:
+			file.setstate(std::ios::failbit);
+			return false;
+		}
+	}
+	*inputs = unpack_inputs(run.inputs);
+	run.ticks -= 1;
+	ticks += 1;
+	return true;
+}
+
+bool ReplayReader::seek(uint64_t tick, GameState *state, Balls *balls_) {
+	assert(state);
+	assert(balls_);
+	file.clear();
+	run.ticks = 0;
+	//the last keyframe at or before 'tick' (or the start of the recording, if there are none):
+	auto after = std::upper_bound(index.begin(), index.end(), tick, [](uint64_t t, ReplayIndexEntry const &entry) {
+		return t < entry.tick;
+	});
+	if (after == index.begin()) {
+		*state = GameState();
+		*balls_ = balls;
+		ticks = 0;
+		file.seekg(runs_start);
+	} else {
+		ReplayIndexEntry const &entry = *(after - 1);
+		file.seekg(entry.offset);
+		ReplayRun marker;
+		if (!read_record(&marker) || marker.ticks != 0 || marker.inputs != ReplayRun::Keyframe) {
+			throw std::runtime_error("Replay seek index doesn't point at a keyframe");
+		}
+		ReplayKeyframe keyframe;
+		std::vector< ReplayBall > records;
+		read_keyframe(&keyframe, &records);
+		if (keyframe.tick != entry.tick) throw std::runtime_error("Replay keyframe is not where the index says");
+
+		for (uint32_t i = 0; i < 2; ++i) {
+			GameState::Paddle &paddle = state->paddles[i];
+			paddle.position = keyframe.paddles[i].position;
+			paddle.angle = keyframe.paddles[i].angle;
+			paddle.clockwise = keyframe.paddles[i].clockwise;
+			paddle.changing = (keyframe.paddles[i].changing != 0);
+			paddle.normal = keyframe.paddles[i].normal;
+		}
+		state->ball.position = keyframe.ball_position;
+		state->ball.velocity = keyframe.ball_velocity;
+		state->ball.hit = uint8_t(keyframe.ball_hit);
+		state->winner = keyframe.winner;
+		balls_->clear();
+		for (auto const &record : records) {
+			balls_->add(glm::vec3(record.x, record.y, record.z), glm::vec3(record.vx, record.vy, 0.0f));
+			balls_->hit.back() = uint8_t(record.hit);
+		}
+		ticks = keyframe.tick;
+	}
+
+	//then play the rest of the way (the same step main uses):
+	BallGrid grid(-arena.half_size, arena.half_size);
+	GameInputs inputs;
+	while (ticks < tick && next(&inputs)) {
+		step(arena, *state, *balls_, grid, inputs, TickElapsed);
+	}
+	return ticks == tick;
+}
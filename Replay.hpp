@@ -0,0 +1,149 @@
+#pragma once
+
+#include "Game.hpp"
+#include "Balls.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//Recordings of the inputs of a match, which (since the rules are deterministic
+// and stepped at a fixed rate) are enough to play the whole match again.
+//
+//A recording file is:
+//  ReplayHeader (field size and tuning)
+//  'pil0' chunk of ReplayPillar (the arena's pillars, exactly as the rules see them)
+//  'bal0' chunk of glm::vec3 (starting positions of the extra balls of multi-ball mode)
+//  ReplayRun records until the end of the file, with a keyframe every keyframe_ticks ticks:
+//    ReplayRun{ReplayRun::Keyframe, 0}, ReplayKeyframe, ReplayKeyframe::balls x ReplayBall
+//  and, if the recording was closed properly, a seek index at the end:
+//    ReplayRun{ReplayRun::Index, 0}, 'idx0' chunk of ReplayIndexEntry, ReplayFooter
+//Each run is one set of inputs (both players, packed into 10 bits) and how many
+// ticks in a row it was held. Inputs change a few times a second at most, so a
+// minute of play (14400 ticks) is usually a few kilobytes. Runs are written as
+// they finish, so a recording cut short by a crash still plays up to that point
+// (and can still be seeked -- the reader finds the keyframes itself if the index is missing).
+//
+//A keyframe is the whole match state at the start of its tick, so playback can jump to
+// any tick by restoring the keyframe before it and stepping at most keyframe_ticks ticks
+// (see ReplayReader::seek). At the default of one every two seconds they add about 4 kilobytes
+// a minute in single-ball play.
+
+struct ReplayHeader {
+	char magic[4] = {'r', 'p', 'l', '0'};
+	uint32_t version = 3; //(2: rules use SimMath.hpp -- version 1 recordings would play out differently; 3: keyframes)
+	float tick_elapsed = TickElapsed; //replays only make sense at the rate they were recorded
+	glm::vec2 half_size = glm::vec2(0.0f);
+	Tuning tuning;
+	uint32_t keyframe_ticks = 480; //ticks between keyframes
+};
+static_assert(sizeof(ReplayHeader) == 48, "Replay header should be packed");
+
+struct ReplayPillar {
+	float x, y, z;
+	float radius2, reach2;
+};
+static_assert(sizeof(ReplayPillar) == 20, "Replay pillar should be packed");
+
+struct ReplayRun {
+	uint16_t inputs; //see pack_inputs
+	uint16_t ticks; //(zero only for markers, which say what follows in 'inputs':)
+	enum : uint16_t {
+		Keyframe = 1,
+		Index = 2,
+	};
+};
+static_assert(sizeof(ReplayRun) == 4, "Replay run should be packed");
+
+//GameState, field by field (so the layout doesn't depend on the compiler's padding):
+struct ReplayKeyframe {
+	uint64_t tick; //state as of the start of this tick
+	struct Paddle {
+		glm::vec3 position;
+		float angle, clockwise;
+		uint32_t changing;
+		glm::vec3 normal;
+	} paddles[2];
+	glm::vec3 ball_position, ball_velocity;
+	uint32_t ball_hit;
+	int32_t winner;
+	uint32_t balls; //ReplayBall records that follow
+	uint32_t padding = 0;
+};
+static_assert(sizeof(ReplayKeyframe) == 120, "Replay keyframe should be packed");
+
+struct ReplayBall {
+	float x, y, z;
+	float vx, vy;
+	uint32_t hit;
+};
+static_assert(sizeof(ReplayBall) == 24, "Replay ball should be packed");
+
+struct ReplayIndexEntry {
+	uint64_t tick; //of a keyframe
+	uint64_t offset; //file offset of its marker
+};
+static_assert(sizeof(ReplayIndexEntry) == 16, "Replay index entry should be packed");
+
+//last thing in a properly closed recording:
+struct ReplayFooter {
+	char magic[4] = {'r', 'p', 'x', '0'};
+	uint32_t padding = 0;
+	uint64_t ticks = 0; //in the whole recording
+	uint64_t index = 0; //file offset of the index marker
+};
+static_assert(sizeof(ReplayFooter) == 24, "Replay footer should be packed");
+
+//both players' inputs as bits (player 0 in the low five: left, right, up, down, toggle):
+uint16_t pack_inputs(GameInputs const &inputs);
+GameInputs unpack_inputs(uint16_t bits);
+
+//Writes a recording as the match is played (throws if the file can't be written):
+struct ReplayWriter {
+	ReplayWriter(std::string const &filename, Arena const &arena, Balls const &balls, uint32_t keyframe_ticks = ReplayHeader().keyframe_ticks);
+	~ReplayWriter(); //writes the last run and the seek index
+
+	//call once per tick, before stepping, with the inputs and the state they are about to step:
+	// (the state only goes in the file every keyframe_ticks ticks)
+	void record(GameInputs const &inputs, GameState const &state, Balls const &balls);
+
+	uint64_t ticks = 0; //recorded so far
+	const uint32_t keyframe_ticks;
+
+private:
+	std::ofstream file;
+	ReplayRun run; //still being held (run.ticks == 0 before the first tick)
+	std::vector< ReplayIndexEntry > index;
+	void write_run();
+	void write_keyframe(GameState const &state, Balls const &balls);
+};
+
+//Reads a recording back (throws on bad data):
+struct ReplayReader {
+	explicit ReplayReader(std::string const &filename);
+
+	Arena arena; //colliders and tuning the match was played with
+	Balls balls; //extra balls, as they were at the start
+
+	//inputs for the next tick; false once the recording is over:
+	bool next(GameInputs *inputs);
+
+	//jump to the start of 'tick': sets 'state' and 'balls' to the match as it was then
+	// (restoring the keyframe before it and stepping the rest), and next() carries on from there.
+	// Returns false if the recording ends first (leaving the state as of its end):
+	bool seek(uint64_t tick, GameState *state, Balls *balls);
+
+	uint64_t ticks = 0; //played back so far
+	uint64_t length = 0; //ticks in the whole recording
+	uint32_t keyframe_ticks = 0;
+	std::vector< ReplayIndexEntry > index; //every keyframe, in tick order
+
+private:
+	std::ifstream file;
+	uint64_t runs_start = 0; //file offset of the first run
+	ReplayRun run; //being played back (run.ticks is how many ticks of it are left)
+	bool read_record(ReplayRun *record);
+	void read_keyframe(ReplayKeyframe *keyframe, std::vector< ReplayBall > *balls);
+	void scan(); //find the keyframes (and length) of a recording without an index
+};
@@ -0,0 +1,107 @@
+#include "Rollback.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+constexpr uint32_t Rollback::Ring;
+constexpr uint32_t Rollback::MaxPrediction;
+
+static_assert(Rollback::MaxPrediction * 2 <= Rollback::Ring, "history must cover every tick that might be re-simulated, plus the local inputs queued ahead");
+
+static bool same_input(PlayerInput const &a, PlayerInput const &b) {
+	return a.left == b.left && a.right == b.right && a.up == b.up && a.down == b.down && a.toggle == b.toggle;
+}
+
+Rollback::Rollback(Arena const &arena_, uint32_t local_player_, uint32_t input_delay_)
+	: arena(arena_), local_player(local_player_), input_delay(input_delay_), remote_confirmed(input_delay_), frames(Ring) {
+	assert(local_player < 2);
+	assert(input_delay < MaxPrediction);
+	//(inputs for the first input_delay ticks are nothing held, on both sides -- which frames[] already says)
+}
+
+void Rollback::advance(PlayerInput const &local) {
+	assert(can_advance());
+	correct();
+	frames[local_end() % Ring].inputs[local_player] = local;
+	simulate();
+	update_checksums();
+}
+
+void Rollback::simulate() {
+	Frame &frame = frames[tick % Ring];
+	uint32_t remote = 1 - local_player;
+	if (tick >= remote_confirmed) {
+		//predict: the remote holds whatever they held last:
+		frame.inputs[remote] = (remote_confirmed > 0 ? frames[(remote_confirmed - 1) % Ring].inputs[remote] : PlayerInput());
+	}
+	frame.state = state;
+
+	GameInputs inputs;
+	inputs.players[0] = frame.inputs[0];
+	inputs.players[1] = frame.inputs[1];
+	step(arena, state, inputs, TickElapsed);
+	tick += 1;
+}
+
+void Rollback::receive_remote(uint32_t for_tick, PlayerInput const &input) {
+	if (for_tick != remote_confirmed) return; //old news, or out of order (will be sent again)
+	if (for_tick >= tick + MaxPrediction) return; //so far ahead it would overwrite history we need (will be sent again)
+
+	Frame &frame = frames[for_tick % Ring];
+	uint32_t remote = 1 - local_player;
+	if (for_tick < tick && !same_input(frame.inputs[remote], input)) {
+		mispredicted = std::min(mispredicted, for_tick);
+	}
+	frame.inputs[remote] = input;
+	remote_confirmed += 1;
+	update_checksums();
+}
+
+uint32_t Rollback::correct() {
+	if (mispredicted == -1U) return 0;
+	assert(mispredicted < tick && mispredicted + Ring > tick);
+
+	uint32_t from = mispredicted;
+	uint32_t end = tick;
+	mispredicted = -1U;
+	tick = from;
+	state = frames[tick % Ring].state;
+	while (tick < end) {
+		simulate();
+	}
+	update_checksums();
+	return end - from;
+}
+
+PlayerInput const &Rollback::local_input(uint32_t for_tick) const {
+	assert(for_tick < local_end() && for_tick + MaxPrediction >= local_end());
+	return frames[for_tick % Ring].inputs[local_player];
+}
+
+void Rollback::update_checksums() {
+	if (mispredicted != -1U) return; //(states after a misprediction aren't final)
+	//the state at the start of tick t is final once every input before t is:
+	uint32_t end = std::min(remote_confirmed + 1, tick);
+	for (; checksummed < end; ++checksummed) {
+		Frame &frame = frames[checksummed % Ring];
+		frame.checksum = roll_hash(rolling_before(checksummed), state_hash(frame.state));
+	}
+}
+
+uint32_t Rollback::rolling_before(uint32_t at) const {
+	assert(at <= checksummed);
+	return (at == 0 ? 0 : frames[(at - 1) % Ring].checksum);
+}
+
+bool Rollback::final_checksum(uint32_t at, uint32_t *checksum) const {
+	assert(checksum);
+	if (at < checksummed && at + Ring >= tick) {
+		*checksum = frames[at % Ring].checksum;
+		return true;
+	}
+	if (at == tick && at == checksummed && at <= remote_confirmed && mispredicted == -1U) {
+		*checksum = roll_hash(rolling_before(at), state_hash(state));
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Game.hpp"
+
+#include <vector>
+#include <cstdint>
+
+//Rollback ("GGPO-style") simulation for a match with one local and one remote player.
+// Every tick runs straight away with the local input and a *prediction* of the
+// remote input (whatever they held last). When the remote's real inputs arrive,
+// any tick that was predicted wrong is fixed by restoring the snapshot taken at
+// its start and re-simulating up to the present. Snapshots are GameState copies
+// (see the note in Game.hpp), so this only works for single-ball matches.
+//
+//Local inputs take effect 'input_delay' ticks after they are given, which hides
+// that much of the latency without any re-simulation.
+//
+//Nothing here knows about sockets; see Net.hpp for the part that sends inputs around.
+
+struct Rollback {
+	//ticks of history kept (snapshots and inputs):
+	static constexpr uint32_t Ring = 128;
+	//farthest the simulation may run ahead of the remote inputs it has (~0.27s):
+	static constexpr uint32_t MaxPrediction = 64;
+
+	Rollback(Arena const &arena, uint32_t local_player, uint32_t input_delay = 2);
+
+	Arena arena;
+	uint32_t local_player; //0 or 1
+	uint32_t input_delay; //(both players must use the same one)
+
+	//state at the start of tick 'tick' (so far as currently predicted):
+	GameState state;
+	uint32_t tick = 0;
+
+	//remote inputs are known for every tick before this one:
+	uint32_t remote_confirmed;
+
+	//false when running another tick would predict too far ahead:
+	bool can_advance() const { return tick < remote_confirmed + MaxPrediction; }
+	//give the local input (it applies to tick + input_delay) and run one tick:
+	void advance(PlayerInput const &local);
+
+	//a remote input (ignored unless it is for tick 'remote_confirmed' -- inputs arrive in order or not at all):
+	void receive_remote(uint32_t for_tick, PlayerInput const &input);
+
+	//re-simulate from the first mispredicted tick, if any; returns the number of ticks re-simulated:
+	uint32_t correct();
+
+	//local inputs are known for ticks before this one:
+	uint32_t local_end() const { return tick + input_delay; }
+	PlayerInput const &local_input(uint32_t for_tick) const;
+
+	//rolling hash (see roll_hash in Game.hpp) of the states at the start of every tick up to and
+	// including 'at', once no later input can change them (i.e. at <= remote_confirmed and
+	// at <= tick, after correct()); false if not (or no longer) known. Peers that agree on
+	// one tick's checksum agree on every tick before it too:
+	bool final_checksum(uint32_t at, uint32_t *checksum) const;
+
+private:
+	struct Frame {
+		GameState state; //at the start of the tick
+		PlayerInput inputs[2]; //(remote one may be a prediction)
+		uint32_t checksum = 0; //rolling hash up to 'state', once final
+	};
+	std::vector< Frame > frames; //frames[t % Ring] is tick t
+	uint32_t mispredicted = -1U; //earliest tick run with a wrong remote input
+	uint32_t checksummed = 0; //ticks before this have Frame::checksum filled in
+
+	void simulate(); //run tick 'tick' (predicting the remote input if needed)
+	void update_checksums();
+	uint32_t rolling_before(uint32_t at) const; //checksum of tick at - 1 (0 for tick 0)
+};
@@ -1,146 +1,28 @@
 #include "Scene.hpp"
 
-#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
 
-glm::mat4 Scene::Transform::make_local_to_parent() const {
-	return glm::mat4( //translate
-		glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
-		glm::vec4(0.0f, 1.0f, 0.0f, 0.0f),
-		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
-		glm::vec4(position, 1.0f)
-	)
-	* glm::mat4_cast(rotation) //rotate
-	* glm::mat4( //scale
-		glm::vec4(scale.x, 0.0f, 0.0f, 0.0f),
-		glm::vec4(0.0f, scale.y, 0.0f, 0.0f),
-		glm::vec4(0.0f, 0.0f, scale.z, 0.0f),
-		glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
-	);
-}
-
-glm::mat4 Scene::Transform::make_parent_to_local() const {
-	glm::vec3 inv_scale;
-	inv_scale.x = (scale.x == 0.0f ? 0.0f : 1.0f / scale.x);
-	inv_scale.y = (scale.y == 0.0f ? 0.0f : 1.0f / scale.y);
-	inv_scale.z = (scale.z == 0.0f ? 0.0f : 1.0f / scale.z);
-	return glm::mat4( //un-scale
-		glm::vec4(inv_scale.x, 0.0f, 0.0f, 0.0f),
-		glm::vec4(0.0f, inv_scale.y, 0.0f, 0.0f),
-		glm::vec4(0.0f, 0.0f, inv_scale.z, 0.0f),
-		glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
-	)
-	* glm::mat4_cast(glm::inverse(rotation)) //un-rotate
-	* glm::mat4( //un-translate
-		glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
-		glm::vec4(0.0f, 1.0f, 0.0f, 0.0f),
-		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
-		glm::vec4(-position, 1.0f)
-	);
-}
-
-glm::mat4 Scene::Transform::make_local_to_world() const {
-	if (parent) {
-		return parent->make_local_to_world() * make_local_to_parent();
-	} else {
-		return make_local_to_parent();
-	}
-}
-
-glm::mat4 Scene::Transform::make_world_to_local() const {
-	if (parent) {
-		return make_parent_to_local() * parent->make_world_to_local();
-	} else {
-		return make_parent_to_local();
-	}
-}
-
-void Scene::Transform::DEBUG_assert_valid_pointers() const {
-	if (parent == nullptr) {
-		//if no parent, can't have siblings:
-		assert(prev_sibling == nullptr);
-		assert(next_sibling == nullptr);
-	} else {
-		//if have parent, last child if and only if no next sibling:
-		assert((next_sibling == nullptr) == (this == parent->last_child));
-	}
-	//check proper return pointers from neighbors:
-	assert(prev_sibling == nullptr || prev_sibling->next_sibling == this);
-	assert(next_sibling == nullptr || next_sibling->prev_sibling == this);
-	assert(last_child == nullptr || last_child->parent == this);
-}
-
-
-void Scene::Transform::set_parent(Transform *new_parent, Transform *before) {
-	DEBUG_assert_valid_pointers();
-	assert(before == nullptr || (new_parent != nullptr && before->parent == new_parent));
-	if (parent) {
-		//remove from existing parent:
-		if (prev_sibling) prev_sibling->next_sibling = next_sibling;
-		if (next_sibling) next_sibling->prev_sibling = prev_sibling;
-		else parent->last_child = prev_sibling;
-		next_sibling = prev_sibling = nullptr;
-	}
-	parent = new_parent;
-	if (parent) {
-		//add to new parent:
-		if (before) {
-			prev_sibling = before->prev_sibling;
-			next_sibling = before;
-			next_sibling->prev_sibling = this;
-		} else {
-			prev_sibling = parent->last_child;
-			parent->last_child = this;
-		}
-		if (prev_sibling) prev_sibling->next_sibling = this;
-	}
-	DEBUG_assert_valid_pointers();
-}
-
-//---------------------------
-
-glm::mat4 Scene::Camera::make_projection() const {
-	return glm::infinitePerspective( fovy, aspect, near );
-}
-
-//---------------------------
-
-void Scene::render() {
-	glm::mat4 world_to_camera = camera.transform.make_world_to_local();
-	glm::mat4 world_to_clip = camera.make_projection() * world_to_camera;
-
-	//Get world-space position of all lights:
-	for (auto const &light : lights) {
-		glm::mat4 mv = world_to_camera * light.transform.make_local_to_world();
-		(void)mv;
-	}
-
-	for (auto const &object : objects) {
-		glm::mat4 local_to_world = object.transform.make_local_to_world();
-
-		//compute modelview+projection (object space to clip space) matrix for this object:
-		glm::mat4 mvp = world_to_clip * local_to_world;
-
-		//compute modelview (object space to camera local space) matrix for this object:
-		glm::mat4 mv = world_to_camera * local_to_world;
-
-		//NOTE: inverse cancels out transpose unless there is scale involved
-		glm::mat3 itmv = glm::inverse(glm::transpose(glm::mat3(mv)));
-
+void Scene::submit() const {
+	for (auto const &draw : draws) {
 		//set up program uniforms:
-		glUseProgram(object.program);
-		if (object.program_mvp != -1U) {
-			glUniformMatrix4fv(object.program_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+		glUseProgram(draw.program);
+		if (draw.program_mvp != -1U) {
+			glUniformMatrix4fv(draw.program_mvp, 1, GL_FALSE, glm::value_ptr(draw.mvp));
 		}
-		if (object.program_itmv != -1U) {
-			glUniformMatrix3fv(object.program_itmv, 1, GL_FALSE, glm::value_ptr(itmv));
+		if (draw.program_itmv != -1U) {
+			glUniformMatrix3fv(draw.program_itmv, 1, GL_FALSE, glm::value_ptr(draw.itmv));
 		}
 
-		glBindVertexArray(object.vao);
+		glBindVertexArray(draw.vao);
 
 		//draw the object:
-		glDrawArrays(GL_TRIANGLES, object.start, object.count);
+		glDrawArrays(GL_TRIANGLES, draw.start, draw.count);
 	}
 }
+
+void Scene::render() {
+	prepare();
+	submit();
+}
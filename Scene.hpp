@@ -1,31 +1,43 @@
 #pragma once
 
 #include "GL.hpp"
+#include "SlotMap.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <vector>
-#include <list>
 
 #undef near //windows.h steps on this
 
+struct JobPool; //see JobPool.hpp
+
+//Inverse of a local-to-world matrix built from positions, rotations, and scales, without
+// a general 4x4 inverse: when the 3x3 part's columns are at right angles (rotation times
+// scale -- anything but a non-uniform scale under a rotation, which shears) the inverse
+// is the transposed rotation with the scale inverted, i.e. each column over its squared
+// length, turned into a row. Sheared ones fall back to a 3x3 inverse. Either way the
+// translation is undone last. (Zero scales invert to zero, as in make_parent_to_local.)
+glm::mat4 affine_inverse(glm::mat4 const &local_to_world);
+
 //Describes a 3D scene for rendering:
 struct Scene {
 	struct Transform {
 		Transform() = default;
-		Transform(Transform &) = delete;
+		Transform(Transform const &) = delete;
+		Transform &operator=(Transform const &) = delete;
+		//moving takes over the other transform's place in the hierarchy (so objects can live in a SlotMap):
+		Transform(Transform &&other) noexcept;
+		Transform &operator=(Transform &&other) noexcept; //(this one's children are left as roots, as when destroyed)
 		~Transform() {
-			while (last_child) {
-				last_child->set_parent(nullptr);
-			}
-			if (parent) {
-				set_parent(nullptr);
-			}
+			unlink();
 		}
 
-		//simple specification:
-		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
-		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
-		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f);
+		//simple specification (change it with the setters, so the cached matrices below know):
+		glm::vec3 const &get_position() const { return position; }
+		glm::quat const &get_rotation() const { return rotation; }
+		glm::vec3 const &get_scale() const { return scale; }
+		void set_position(glm::vec3 const &position);
+		void set_rotation(glm::quat const &rotation);
+		void set_scale(glm::vec3 const &scale);
 
 		//hierarchy information:
 		Transform *parent = nullptr;
@@ -40,11 +52,36 @@ struct Scene {
 		//helper that checks local pointer consistency:
 		void DEBUG_assert_valid_pointers() const;
 
-		//computed from the above:
+		//computed from the above, cached until this transform or one above it changes
+		// (so a transform nothing has touched costs a flag check; reading these updates
+		//  the cache, so don't read from several threads at once):
+		glm::mat4 const &local_to_parent() const;
+		glm::mat4 const &local_to_world() const;
+		//inverse of the cached local_to_world (see affine_inverse below):
+		glm::mat4 world_to_local() const;
+
+		//computed from the above, from scratch every call:
 		glm::mat4 make_local_to_parent() const;
 		glm::mat4 make_parent_to_local() const;
 		glm::mat4 make_local_to_world() const;
+		//(three matrices per level up the parent chain -- use world_to_local; this one is for checking it)
 		glm::mat4 make_world_to_local() const;
+
+	private:
+		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
+		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f);
+
+		mutable glm::mat4 cached_local_to_parent;
+		mutable glm::mat4 cached_local_to_world;
+		mutable bool local_dirty = true; //position, rotation, or scale changed since cached_local_to_parent
+		mutable bool world_dirty = true; //...or anything above did, since cached_local_to_world
+		//(a dirty transform's descendants are always dirty too, so marking can stop at one that already is)
+		void mark_world_dirty();
+		//leave the hierarchy (children become roots):
+		void unlink();
+		//move 'other' here, and point its neighbors at this one instead:
+		void take_place_of(Transform &other);
 	};
 	struct Camera {
 		Transform transform;
@@ -72,9 +109,28 @@ struct Scene {
 		glm::vec3 intensity = glm::vec3(1.0f, 1.0f, 1.0f); //effectively, color
 	};
 
+	//(values move around as others are removed, so hold on to handles, not pointers -- see SlotMap.hpp)
+	typedef SlotMap< Object >::Handle ObjectHandle;
+	typedef SlotMap< Light >::Handle LightHandle;
+
 	Camera camera;
-	std::list< Object > objects;
-	std::list< Light > lights;
+	SlotMap< Object > objects;
+	SlotMap< Light > lights;
+
+	//What it takes to draw one object this frame, packed so submitting is a walk down an array:
+	struct Draw {
+		glm::mat4 mvp; //object space to clip space
+		glm::mat3 itmv; //inverse(transpose(modelview)), for normals
+		GLuint vao, start, count;
+		GLuint program, program_mvp, program_itmv;
+	};
+	std::vector< Draw > draws; //(as of the last prepare, in the order of 'objects')
 
+	//work out 'draws' from the camera and objects, split into jobs on 'pool' if given
+	// (no GL calls, so it needn't be on the GL thread; call it from the thread that changes the scene):
+	void prepare(JobPool *pool = nullptr);
+	//issue the GL calls for 'draws':
+	void submit() const;
+	//both, on this thread:
 	void render();
 };
@@ -0,0 +1,229 @@
+#include "SceneNodes.hpp"
+#include "JobPool.hpp"
+#include "Scene.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+const SceneNodes::Handle SceneNodes::None;
+
+namespace {
+
+//translate * rotate * scale, written out (the same numbers Scene::Transform::make_local_to_parent gets):
+glm::mat4 local_matrix(glm::vec3 const &position, glm::quat const &rotation, glm::vec3 const &scale) {
+	glm::mat3 r = glm::mat3_cast(rotation);
+	return glm::mat4(
+		glm::vec4(r[0] * scale.x, 0.0f),
+		glm::vec4(r[1] * scale.y, 0.0f),
+		glm::vec4(r[2] * scale.z, 0.0f),
+		glm::vec4(position, 1.0f)
+	);
+}
+
+//array[k] = old array[order[k]]:
+template< typename T >
+void permute(std::vector< uint32_t > const &order, std::vector< T > *array) {
+	std::vector< T > sorted;
+	sorted.reserve(order.size());
+	for (uint32_t i : order) sorted.emplace_back((*array)[i]);
+	array->swap(sorted);
+}
+
+const int32_t Removed = -2; //parent of a removed node (until the next sort drops it)
+
+} //namespace
+
+uint32_t SceneNodes::index_of(Handle node) const {
+	assert(node.slot < slot_index.size() && "handle should name a node");
+	assert(slot_generation[node.slot] == node.generation && "handle's node should not have been removed");
+	return slot_index[node.slot];
+}
+
+SceneNodes::Handle SceneNodes::add(glm::vec3 const &position_, glm::quat const &rotation_, glm::vec3 const &scale_, Handle parent_) {
+	Handle node;
+	if (!free_slots.empty()) {
+		node.slot = free_slots.back();
+		free_slots.pop_back();
+	} else {
+		node.slot = uint32_t(slot_index.size());
+		slot_index.emplace_back(-1U);
+		slot_generation.emplace_back(0);
+	}
+	node.generation = slot_generation[node.slot];
+
+	//(appended, so it comes after any parent it could have)
+	uint32_t index = size();
+	int32_t p = (parent_ == None ? -1 : int32_t(index_of(parent_)));
+	//...but it only stays depth-first if the parent's subtree is the one at the end:
+	if (p >= 0 && depth_first) {
+		int32_t above = int32_t(index) - 1;
+		while (above >= 0 && above != p) above = parent[above];
+		if (above != p) depth_first = false;
+	}
+	slot_index[node.slot] = index;
+	parent.emplace_back(p);
+	position.emplace_back(position_);
+	rotation.emplace_back(rotation_);
+	scale.emplace_back(scale_);
+	world.emplace_back(1.0f);
+	dirty.emplace_back(1);
+	slot_of.emplace_back(node.slot);
+	return node;
+}
+
+void SceneNodes::remove(Handle node) {
+	uint32_t index = index_of(node);
+	parent[index] = Removed;
+	removed += 1;
+	slot_index[node.slot] = -1U;
+	slot_generation[node.slot] += 1;
+	free_slots.emplace_back(node.slot);
+}
+
+void SceneNodes::set_parent(Handle node, Handle parent_) {
+	uint32_t index = index_of(node);
+	int32_t p = (parent_ == None ? -1 : int32_t(index_of(parent_)));
+	//(a node can't be its own ancestor)
+	for (int32_t above = p; above >= 0; above = parent[above]) {
+		assert(above != int32_t(index) && "set_parent should not make a cycle");
+	}
+	parent[index] = p;
+	dirty[index] = 1;
+	depth_first = false;
+}
+
+SceneNodes::Handle SceneNodes::get_parent(Handle node) const {
+	int32_t p = parent[index_of(node)];
+	if (p < 0 || parent[p] == Removed) return None;
+	Handle handle;
+	handle.slot = slot_of[p];
+	handle.generation = slot_generation[handle.slot];
+	return handle;
+}
+
+glm::mat4 SceneNodes::world_to_local(Handle node) const {
+	return affine_inverse(world[index_of(node)]);
+}
+
+void SceneNodes::set_position(Handle node, glm::vec3 const &position_) {
+	uint32_t index = index_of(node);
+	position[index] = position_;
+	dirty[index] = 1;
+}
+
+void SceneNodes::set_rotation(Handle node, glm::quat const &rotation_) {
+	uint32_t index = index_of(node);
+	rotation[index] = rotation_;
+	dirty[index] = 1;
+}
+
+void SceneNodes::set_scale(Handle node, glm::vec3 const &scale_) {
+	uint32_t index = index_of(node);
+	scale[index] = scale_;
+	dirty[index] = 1;
+}
+
+void SceneNodes::update(JobPool *pool) {
+	const uint32_t Grain = 16384; //nodes per job (or more, to finish a subtree)
+	bool split = (pool && pool->size() >= 2 && size() > Grain);
+	//(depth-first order also keeps each subtree together in memory, so it's worth restoring even unsplit)
+	if (!depth_first || removed) sort();
+
+	//parents come first, so each world matrix only needs its parent's (already done) one:
+	auto update_range = [this](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			int32_t p = parent[i];
+			if (p >= 0) {
+				if (dirty[p]) dirty[i] = 1;
+				if (!dirty[i]) continue;
+				world[i] = world[p] * local_matrix(position[i], rotation[i], scale[i]);
+			} else {
+				if (!dirty[i]) continue;
+				world[i] = local_matrix(position[i], rotation[i], scale[i]);
+			}
+		}
+	};
+
+	uint32_t count = size();
+	if (!split) {
+		update_range(0, count);
+		std::fill(dirty.begin(), dirty.end(), uint8_t(0));
+		return;
+	}
+	//each subtree is one run of the arrays starting at its root, so split only at roots:
+	for (uint32_t begin = 0; begin < count; ) {
+		uint32_t end = std::min(count, begin + Grain);
+		while (end < count && parent[end] >= 0) ++end;
+		pool->submit([this, &update_range, begin, end]() {
+			update_range(begin, end);
+			std::fill(dirty.begin() + begin, dirty.begin() + end, uint8_t(0));
+		});
+		begin = end;
+	}
+	pool->wait();
+}
+
+void SceneNodes::sort() {
+	uint32_t count = size();
+
+	//children of each node, in index order (as offsets into 'children'):
+	std::vector< uint32_t > first(count + 1, 0);
+	std::vector< uint32_t > roots;
+	for (uint32_t i = 0; i < count; ++i) {
+		int32_t p = parent[i];
+		if (p == Removed) continue;
+		if (p >= 0 && parent[p] == Removed) {
+			//(the children of a removed node are left as roots)
+			parent[i] = p = -1;
+			dirty[i] = 1;
+		}
+		if (p >= 0) first[p + 1] += 1;
+		else roots.emplace_back(i);
+	}
+	for (uint32_t i = 0; i < count; ++i) {
+		first[i + 1] += first[i];
+	}
+	std::vector< uint32_t > children(first[count]);
+	{
+		std::vector< uint32_t > next(first.begin(), first.end() - 1);
+		for (uint32_t i = 0; i < count; ++i) {
+			if (parent[i] >= 0) children[next[parent[i]]++] = i;
+		}
+	}
+
+	//depth-first order (so each subtree ends up in one piece):
+	std::vector< uint32_t > order;
+	order.reserve(count - removed);
+	std::vector< uint32_t > stack;
+	for (auto r = roots.rbegin(); r != roots.rend(); ++r) {
+		stack.emplace_back(*r);
+	}
+	while (!stack.empty()) {
+		uint32_t i = stack.back();
+		stack.pop_back();
+		order.emplace_back(i);
+		for (uint32_t c = first[i + 1]; c > first[i]; --c) {
+			stack.emplace_back(children[c - 1]);
+		}
+	}
+	assert(order.size() == count - removed);
+
+	std::vector< int32_t > new_index(count, -1);
+	for (uint32_t k = 0; k < order.size(); ++k) {
+		new_index[order[k]] = int32_t(k);
+	}
+	permute(order, &position);
+	permute(order, &rotation);
+	permute(order, &scale);
+	permute(order, &world);
+	permute(order, &dirty);
+	permute(order, &slot_of);
+	permute(order, &parent);
+	for (uint32_t k = 0; k < order.size(); ++k) {
+		if (parent[k] >= 0) parent[k] = new_index[parent[k]];
+		slot_index[slot_of[k]] = k;
+	}
+
+	depth_first = true;
+	removed = 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <cstdint>
+
+struct JobPool; //see JobPool.hpp
+
+//Transforms for big scenes, as flat arrays instead of linked Scene::Transforms:
+// nodes are kept sorted so every parent comes before its children (depth-first, so
+// each subtree is one contiguous run), with parents as int32 indices. World matrices
+// are then one forward pass over the arrays -- a node's parent is always finished by
+// the time it is reached -- skipping nodes where nothing above or at them changed.
+//
+//Nodes are named by Handles, which stay valid as the arrays are re-sorted (and are
+// caught, in debug builds, if used after their node was removed). Re-parenting works
+// as Scene::Transform::set_parent does: the node keeps its local transform, now
+// relative to the new parent, and removing a node leaves its children as roots.
+// Changes to the hierarchy are sorted out on the next update().
+
+struct SceneNodes {
+	struct Handle {
+		uint32_t slot = -1U;
+		uint32_t generation = 0;
+		bool operator==(Handle const &other) const { return slot == other.slot && generation == other.generation; }
+		bool operator!=(Handle const &other) const { return !(*this == other); }
+	};
+	static const Handle None; //(a parent of None makes a root)
+
+	Handle add(glm::vec3 const &position, glm::quat const &rotation, glm::vec3 const &scale, Handle parent = None);
+	void remove(Handle node);
+
+	void set_parent(Handle node, Handle parent);
+	Handle get_parent(Handle node) const;
+
+	void set_position(Handle node, glm::vec3 const &position);
+	void set_rotation(Handle node, glm::quat const &rotation);
+	void set_scale(Handle node, glm::vec3 const &scale);
+	glm::vec3 const &get_position(Handle node) const { return position[index_of(node)]; }
+	glm::quat const &get_rotation(Handle node) const { return rotation[index_of(node)]; }
+	glm::vec3 const &get_scale(Handle node) const { return scale[index_of(node)]; }
+
+	//re-sort (if the hierarchy changed) and bring every world matrix up to date
+	// (subtrees don't depend on each other, so with a 'pool' runs of them are done as separate jobs):
+	void update(JobPool *pool = nullptr);
+	//as of the last update():
+	glm::mat4 const &local_to_world(Handle node) const { return world[index_of(node)]; }
+	glm::mat4 world_to_local(Handle node) const; //(see affine_inverse in Scene.hpp)
+
+	uint32_t size() const { return uint32_t(parent.size()); }
+
+	//The arrays, in parent-before-child order (read-only outside of update, please):
+	std::vector< int32_t > parent; //index of the parent, or -1 for a root
+	std::vector< glm::vec3 > position;
+	std::vector< glm::quat > rotation;
+	std::vector< glm::vec3 > scale;
+	std::vector< glm::mat4 > world; //local-to-world
+	std::vector< uint8_t > dirty; //local transform (or parent) changed since the last update
+	std::vector< uint32_t > slot_of; //slot of the node at each index
+
+	uint32_t index_of(Handle node) const;
+
+private:
+	std::vector< uint32_t > slot_index; //index of each slot's node (-1U when free)
+	std::vector< uint32_t > slot_generation; //bumped when a slot's node is removed
+	std::vector< uint32_t > free_slots;
+	bool depth_first = true; //each subtree is one run (false after most hierarchy changes)
+	uint32_t removed = 0; //nodes removed since the last sort (left in place with parent -2)
+	void sort();
+};
@@ -0,0 +1,98 @@
+#include "Scene.hpp"
+#include "JobPool.hpp"
+
+//The per-frame matrix work of drawing a Scene (no OpenGL calls -- those are in Scene.cpp),
+// where the headless tools can link it (see "bench prepare").
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <utility>
+
+glm::mat4 Scene::Camera::make_projection() const {
+	return glm::infinitePerspective( fovy, aspect, near );
+}
+
+//---------------------------
+
+void Scene::prepare(JobPool *pool) {
+	glm::mat4 world_to_camera = camera.transform.world_to_local();
+	glm::mat4 world_to_clip = camera.make_projection() * world_to_camera;
+
+	//Get world-space position of all lights:
+	for (auto const &light : lights) {
+		glm::mat4 mv = world_to_camera * light.transform.local_to_world();
+		(void)mv;
+	}
+
+	uint32_t count = objects.size();
+	draws.resize(count);
+	Object const *first = (count ? &*objects.begin() : nullptr);
+	auto prepare_object = [&](uint32_t i) {
+		Object const &object = first[i];
+		glm::mat4 const &local_to_world = object.transform.local_to_world();
+		Draw &draw = draws[i];
+
+		//compute modelview+projection (object space to clip space) matrix for this object:
+		draw.mvp = world_to_clip * local_to_world;
+
+		//compute modelview (object space to camera local space) matrix for this object:
+		glm::mat4 mv = world_to_camera * local_to_world;
+
+		//NOTE: inverse cancels out transpose unless there is scale involved
+		draw.itmv = glm::inverse(glm::transpose(glm::mat3(mv)));
+
+		draw.vao = object.vao;
+		draw.start = object.start;
+		draw.count = object.count;
+		draw.program = object.program;
+		draw.program_mvp = object.program_mvp;
+		draw.program_itmv = object.program_itmv;
+	};
+
+	const uint32_t Grain = 1024; //objects per job
+	if (!pool || pool->size() < 2 || count <= Grain) {
+		for (uint32_t i = 0; i < count; ++i) {
+			prepare_object(i);
+		}
+		return;
+	}
+
+	//Reading a world matrix fills in the caches of the transform and everything above it,
+	// so no two jobs may read from the same tree. Objects at the root of their trees only
+	// touch their own transforms, so they can be split up any which way; the others are
+	// set aside (with their roots -- finding those only reads the hierarchy pointers, which
+	// nothing changes meanwhile) and go after, grouped so each tree is done by one job:
+	uint32_t jobs = (count + Grain - 1) / Grain;
+	std::vector< std::vector< std::pair< uintptr_t, uint32_t > > > set_aside(jobs); //(root transform, object) per job
+	pool->parallel_for(count, Grain, [&](uint32_t begin, uint32_t end) {
+		auto &nested = set_aside[begin / Grain];
+		for (uint32_t i = begin; i < end; ++i) {
+			Transform const *root = first[i].transform.parent;
+			if (!root) {
+				prepare_object(i);
+				continue;
+			}
+			while (root->parent) root = root->parent;
+			nested.emplace_back(reinterpret_cast< uintptr_t >(root), i);
+		}
+	});
+	std::vector< std::pair< uintptr_t, uint32_t > > nested;
+	for (auto const &some : set_aside) {
+		nested.insert(nested.end(), some.begin(), some.end());
+	}
+	if (nested.empty()) return;
+	//(objects' own transforms are in one array, so this also keeps memory order within a tree)
+	std::sort(nested.begin(), nested.end());
+	for (uint32_t begin = 0; begin < nested.size(); ) {
+		uint32_t end = std::min(uint32_t(nested.size()), begin + Grain);
+		while (end < nested.size() && nested[end].first == nested[end - 1].first) ++end; //(don't split a tree)
+		pool->submit([&nested, &prepare_object, begin, end]() {
+			for (uint32_t n = begin; n < end; ++n) {
+				prepare_object(nested[n].second);
+			}
+		});
+		begin = end;
+	}
+	pool->wait();
+}
@@ -0,0 +1,226 @@
+#include "Scene.hpp"
+
+//Scene::Transform is plain bookkeeping (no OpenGL calls), so it lives apart from
+// Scene::render, where the headless tools can link it (see "bench transforms").
+
+#include <cassert>
+
+glm::mat4 affine_inverse(glm::mat4 const &m) {
+	glm::vec3 c0 = glm::vec3(m[0]), c1 = glm::vec3(m[1]), c2 = glm::vec3(m[2]);
+	float l0 = glm::dot(c0, c0), l1 = glm::dot(c1, c1), l2 = glm::dot(c2, c2);
+	//(a little slack, since a long parent chain doesn't keep right angles exactly)
+	const float Slack = 1e-5f;
+	auto right_angle = [Slack](glm::vec3 const &a, glm::vec3 const &b, float la, float lb) {
+		float d = glm::dot(a, b);
+		return d * d <= Slack * Slack * la * lb;
+	};
+	glm::mat3 inverse;
+	if (right_angle(c0, c1, l0, l1) && right_angle(c0, c2, l0, l2) && right_angle(c1, c2, l1, l2)) {
+		glm::vec3 r0 = (l0 == 0.0f ? glm::vec3(0.0f) : c0 / l0);
+		glm::vec3 r1 = (l1 == 0.0f ? glm::vec3(0.0f) : c1 / l1);
+		glm::vec3 r2 = (l2 == 0.0f ? glm::vec3(0.0f) : c2 / l2);
+		inverse = glm::transpose(glm::mat3(r0, r1, r2));
+	} else {
+		inverse = glm::inverse(glm::mat3(m));
+	}
+	glm::vec3 t = -(inverse * glm::vec3(m[3]));
+	return glm::mat4(
+		glm::vec4(inverse[0], 0.0f),
+		glm::vec4(inverse[1], 0.0f),
+		glm::vec4(inverse[2], 0.0f),
+		glm::vec4(t, 1.0f)
+	);
+}
+
+//---------------------------
+
+Scene::Transform::Transform(Transform &&other) noexcept {
+	take_place_of(other);
+}
+
+Scene::Transform &Scene::Transform::operator=(Transform &&other) noexcept {
+	if (this != &other) {
+		unlink();
+		take_place_of(other);
+	}
+	return *this;
+}
+
+void Scene::Transform::unlink() {
+	while (last_child) {
+		last_child->set_parent(nullptr);
+	}
+	if (parent) {
+		set_parent(nullptr);
+	}
+}
+
+void Scene::Transform::take_place_of(Transform &other) {
+	assert(!parent && !last_child && !prev_sibling && !next_sibling);
+	position = other.position;
+	rotation = other.rotation;
+	scale = other.scale;
+	//(where it is in the world doesn't change, so neither do the cached matrices)
+	cached_local_to_parent = other.cached_local_to_parent;
+	cached_local_to_world = other.cached_local_to_world;
+	local_dirty = other.local_dirty;
+	world_dirty = other.world_dirty;
+
+	parent = other.parent;
+	last_child = other.last_child;
+	prev_sibling = other.prev_sibling;
+	next_sibling = other.next_sibling;
+	other.parent = other.last_child = other.prev_sibling = other.next_sibling = nullptr;
+	if (prev_sibling) prev_sibling->next_sibling = this;
+	if (next_sibling) next_sibling->prev_sibling = this;
+	else if (parent) parent->last_child = this;
+	for (Transform *child = last_child; child; child = child->prev_sibling) {
+		child->parent = this;
+	}
+}
+
+void Scene::Transform::set_position(glm::vec3 const &position_) {
+	position = position_;
+	local_dirty = true;
+	mark_world_dirty();
+}
+
+void Scene::Transform::set_rotation(glm::quat const &rotation_) {
+	rotation = rotation_;
+	local_dirty = true;
+	mark_world_dirty();
+}
+
+void Scene::Transform::set_scale(glm::vec3 const &scale_) {
+	scale = scale_;
+	local_dirty = true;
+	mark_world_dirty();
+}
+
+void Scene::Transform::mark_world_dirty() {
+	if (world_dirty) return;
+	world_dirty = true;
+	for (Transform *child = last_child; child; child = child->prev_sibling) {
+		child->mark_world_dirty();
+	}
+}
+
+glm::mat4 const &Scene::Transform::local_to_parent() const {
+	if (local_dirty) {
+		cached_local_to_parent = make_local_to_parent();
+		local_dirty = false;
+	}
+	return cached_local_to_parent;
+}
+
+glm::mat4 const &Scene::Transform::local_to_world() const {
+	if (world_dirty) {
+		//(cleans the parent first, so no clean transform is ever below a dirty one)
+		if (parent) {
+			cached_local_to_world = parent->local_to_world() * local_to_parent();
+		} else {
+			cached_local_to_world = local_to_parent();
+		}
+		world_dirty = false;
+	}
+	return cached_local_to_world;
+}
+
+glm::mat4 Scene::Transform::world_to_local() const {
+	return affine_inverse(local_to_world());
+}
+
+glm::mat4 Scene::Transform::make_local_to_parent() const {
+	return glm::mat4( //translate
+		glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, 1.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
+		glm::vec4(position, 1.0f)
+	)
+	* glm::mat4_cast(rotation) //rotate
+	* glm::mat4( //scale
+		glm::vec4(scale.x, 0.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, scale.y, 0.0f, 0.0f),
+		glm::vec4(0.0f, 0.0f, scale.z, 0.0f),
+		glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
+	);
+}
+
+glm::mat4 Scene::Transform::make_parent_to_local() const {
+	glm::vec3 inv_scale;
+	inv_scale.x = (scale.x == 0.0f ? 0.0f : 1.0f / scale.x);
+	inv_scale.y = (scale.y == 0.0f ? 0.0f : 1.0f / scale.y);
+	inv_scale.z = (scale.z == 0.0f ? 0.0f : 1.0f / scale.z);
+	return glm::mat4( //un-scale
+		glm::vec4(inv_scale.x, 0.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, inv_scale.y, 0.0f, 0.0f),
+		glm::vec4(0.0f, 0.0f, inv_scale.z, 0.0f),
+		glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
+	)
+	* glm::mat4_cast(glm::inverse(rotation)) //un-rotate
+	* glm::mat4( //un-translate
+		glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, 1.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
+		glm::vec4(-position, 1.0f)
+	);
+}
+
+glm::mat4 Scene::Transform::make_local_to_world() const {
+	if (parent) {
+		return parent->make_local_to_world() * make_local_to_parent();
+	} else {
+		return make_local_to_parent();
+	}
+}
+
+glm::mat4 Scene::Transform::make_world_to_local() const {
+	if (parent) {
+		return make_parent_to_local() * parent->make_world_to_local();
+	} else {
+		return make_parent_to_local();
+	}
+}
+
+void Scene::Transform::DEBUG_assert_valid_pointers() const {
+	if (parent == nullptr) {
+		//if no parent, can't have siblings:
+		assert(prev_sibling == nullptr);
+		assert(next_sibling == nullptr);
+	} else {
+		//if have parent, last child if and only if no next sibling:
+		assert((next_sibling == nullptr) == (this == parent->last_child));
+	}
+	//check proper return pointers from neighbors:
+	assert(prev_sibling == nullptr || prev_sibling->next_sibling == this);
+	assert(next_sibling == nullptr || next_sibling->prev_sibling == this);
+	assert(last_child == nullptr || last_child->parent == this);
+}
+
+
+void Scene::Transform::set_parent(Transform *new_parent, Transform *before) {
+	DEBUG_assert_valid_pointers();
+	assert(before == nullptr || (new_parent != nullptr && before->parent == new_parent));
+	if (parent) {
+		//remove from existing parent:
+		if (prev_sibling) prev_sibling->next_sibling = next_sibling;
+		if (next_sibling) next_sibling->prev_sibling = prev_sibling;
+		else parent->last_child = prev_sibling;
+		next_sibling = prev_sibling = nullptr;
+	}
+	parent = new_parent;
+	mark_world_dirty();
+	if (parent) {
+		//add to new parent:
+		if (before) {
+			prev_sibling = before->prev_sibling;
+			next_sibling = before;
+			next_sibling->prev_sibling = this;
+		} else {
+			prev_sibling = parent->last_child;
+			parent->last_child = this;
+		}
+		if (prev_sibling) prev_sibling->next_sibling = this;
+	}
+	DEBUG_assert_valid_pointers();
+}
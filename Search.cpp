@@ -0,0 +1,168 @@
+#include "Search.hpp"
+#include "Bot.hpp"
+#include "JobPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+constexpr uint32_t SearchPlayer::Actions;
+
+SearchPlayer::SearchPlayer(Arena const &arena_, uint32_t player_, JobPool *pool_, SearchConfig const &config_)
+	: arena(arena_), player(player_), pool(pool_), config(config_) {
+	assert(player < 2);
+	assert(config.ticks_per_action > 0);
+}
+
+PlayerInput SearchPlayer::action_input(uint32_t action) {
+	assert(action < Actions);
+	//(action % 9 picks the steering, action / 9 whether toggle is held)
+	uint32_t steer = action % 9;
+	PlayerInput input;
+	input.left = (steer % 3 == 1);
+	input.right = (steer % 3 == 2);
+	input.up = (steer / 3 == 1);
+	input.down = (steer / 3 == 2);
+	input.toggle = (action / 9 == 1);
+	return input;
+}
+
+PlayerInput SearchPlayer::decide(GameState const &state) {
+	auto start = std::chrono::steady_clock::now();
+	auto deadline = start + std::chrono::duration_cast< std::chrono::steady_clock::duration >(std::chrono::duration< float >(config.budget));
+	uint32_t workers = (pool ? pool->size() : 1);
+	trees.resize(workers);
+	decisions += 1;
+	for (uint32_t w = 0; w < workers; ++w) {
+		trees[w].mt.seed(decisions * 7919 + w);
+		//(emptied here too, since workers with no rollouts to run don't grow theirs)
+		trees[w].nodes.clear();
+		trees[w].rollouts = 0;
+	}
+
+	auto iterations_for = [this, workers](uint32_t w) -> uint32_t {
+		if (config.iterations == 0) return 0;
+		return config.iterations / workers + (w < config.iterations % workers ? 1 : 0);
+	};
+	if (pool && workers > 1) {
+		for (uint32_t w = 0; w < workers; ++w) {
+			uint32_t iterations = iterations_for(w);
+			if (config.iterations && iterations == 0) continue;
+			Tree *tree = &trees[w];
+			pool->submit([this, tree, &state, deadline, iterations]() { grow(*tree, state, deadline, iterations); });
+		}
+		pool->wait();
+	} else {
+		grow(trees[0], state, deadline, config.iterations);
+	}
+
+	//add up every tree's opinion of the first move:
+	uint32_t visits[Actions] = {};
+	float values[Actions] = {};
+	last_rollouts = 0;
+	for (auto const &tree : trees) {
+		last_rollouts += tree.rollouts;
+		if (tree.nodes.empty() || tree.nodes[0].first_child == 0) continue;
+		for (uint32_t a = 0; a < Actions; ++a) {
+			Node const &child = tree.nodes[tree.nodes[0].first_child + a];
+			visits[a] += child.visits;
+			values[a] += child.value;
+		}
+	}
+	uint32_t best = 0;
+	for (uint32_t a = 1; a < Actions; ++a) {
+		if (visits[a] > visits[best]) best = a;
+	}
+	last_value = (visits[best] ? values[best] / visits[best] : 0.5f);
+	last_seconds = std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+	if (visits[best] == 0) return chase_ball(state, player); //(no time to search at all)
+	return action_input(best);
+}
+
+void SearchPlayer::play(GameState &state, uint32_t action, uint32_t ticks) const {
+	GameInputs inputs;
+	inputs.players[player] = action_input(action);
+	for (uint32_t t = 0; t < ticks && state.winner == -1; ++t) {
+		inputs.players[1 - player] = chase_ball(state, 1 - player);
+		step(arena, state, inputs, TickElapsed);
+	}
+}
+
+float SearchPlayer::outcome(GameState const &state) const {
+	if (state.winner == int32_t(player)) return 1.0f;
+	if (state.winner != -1) return 0.0f;
+	//no goal yet: judge by where the ball is and where it is going
+	// (player 0 scores past +x, player 1 past -x):
+	float toward = (player == 0 ? 1.0f : -1.0f);
+	float along = toward * state.ball.position.x / arena.half_size.x;
+	float speed = toward * state.ball.velocity.x / 3.0f;
+	float value = 0.5f + 0.3f * along + 0.1f * std::max(-1.0f, std::min(1.0f, speed));
+	return std::max(0.05f, std::min(0.95f, value));
+}
+
+void SearchPlayer::grow(Tree &tree, GameState const &root, std::chrono::steady_clock::time_point deadline, uint32_t iterations) const {
+	tree.nodes.clear();
+	tree.nodes.emplace_back();
+	tree.rollouts = 0;
+
+	std::vector< uint32_t > path;
+	path.reserve(config.max_depth + 1);
+	for (uint32_t i = 0; iterations == 0 || i < iterations; ++i) {
+		//(checking the clock every rollout would cost about as much as a short rollout)
+		if (iterations == 0 && (i % 4) == 0 && std::chrono::steady_clock::now() >= deadline) break;
+
+		GameState state = root;
+		uint32_t ticks = 0;
+		uint32_t node = 0;
+		path.clear();
+		path.emplace_back(node);
+
+		//down the tree, by UCB1, until reaching a move not tried before:
+		for (uint32_t depth = 0; depth < config.max_depth && state.winner == -1 && ticks < config.horizon; ++depth) {
+			if (tree.nodes[node].first_child == 0) {
+				tree.nodes[node].first_child = uint32_t(tree.nodes.size());
+				tree.nodes.resize(tree.nodes.size() + Actions);
+			}
+			Node const &parent = tree.nodes[node];
+			uint32_t pick = -1U;
+			float pick_score = -1.0f;
+			float log_visits = std::log(float(std::max(1U, parent.visits)));
+			uint32_t offset = tree.mt() % Actions; //(so untried moves are tried in a random order)
+			for (uint32_t k = 0; k < Actions; ++k) {
+				uint32_t a = (k + offset) % Actions;
+				Node const &child = tree.nodes[parent.first_child + a];
+				if (child.visits == 0) {
+					pick = a;
+					break;
+				}
+				float score = child.value / child.visits + config.exploration * std::sqrt(log_visits / child.visits);
+				if (score > pick_score) {
+					pick_score = score;
+					pick = a;
+				}
+			}
+			uint32_t child = parent.first_child + pick;
+			uint32_t hold = std::min(config.ticks_per_action, config.horizon - ticks);
+			play(state, pick, hold);
+			ticks += hold;
+			node = child;
+			path.emplace_back(node);
+			if (tree.nodes[node].visits == 0) break;
+		}
+
+		//then random moves (mostly steering; toggling now and then) out to the horizon:
+		while (state.winner == -1 && ticks < config.horizon) {
+			uint32_t action = tree.mt() % 9 + (tree.mt() % 8 == 0 ? 9 : 0);
+			uint32_t hold = std::min(config.ticks_per_action, config.horizon - ticks);
+			play(state, action, hold);
+			ticks += hold;
+		}
+
+		float value = outcome(state);
+		for (uint32_t n : path) {
+			tree.nodes[n].visits += 1;
+			tree.nodes[n].value += value;
+		}
+		tree.rollouts += 1;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Game.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdint>
+
+struct JobPool; //see JobPool.hpp
+
+//A computer player that picks its controls by Monte Carlo tree search over the
+// game rules. Moves are one of 18 actions (nine ways to steer, with or without
+// toggling the spin), each held for a short while. Every decision starts from a
+// copy of the current GameState; the tree is grown by simulating ahead (with the
+// opponent played by chase_ball), and leaves are judged by short random rollouts.
+//
+//With a JobPool, every worker grows its own tree ("root parallel") and their
+// root statistics are added up at the end, so there is no locking while searching.
+
+struct SearchConfig {
+	float budget = 0.004f; //seconds per decision (a quarter of a 60Hz frame)
+	uint32_t iterations = 0; //if not zero: run exactly this many rollouts instead (split over workers)
+	uint32_t ticks_per_action = 20; //how long each move in the tree/rollouts is held
+	uint32_t horizon = 120; //ticks simulated ahead of the current state, tree plus rollout
+	uint32_t max_depth = 3; //moves in the tree before rollouts take over
+	float exploration = 0.7f; //UCB1 constant
+};
+
+struct SearchPlayer {
+	SearchPlayer(Arena const &arena, uint32_t player, JobPool *pool = nullptr, SearchConfig const &config = SearchConfig());
+
+	Arena const &arena;
+	uint32_t player;
+	JobPool *pool; //(may be null: search on the calling thread)
+	SearchConfig config;
+
+	//search from 'state' and return the controls to hold now:
+	// (don't call from a job on 'pool')
+	PlayerInput decide(GameState const &state);
+
+	//about the latest decision:
+	uint32_t last_rollouts = 0;
+	double last_seconds = 0.0;
+	float last_value = 0.0f; //expected outcome of the chosen move, 0 (lose) to 1 (win)
+
+	static constexpr uint32_t Actions = 18;
+	static PlayerInput action_input(uint32_t action);
+
+private:
+	struct Node {
+		uint32_t first_child = 0; //children are [first_child, first_child + Actions) (0: not expanded)
+		uint32_t visits = 0;
+		float value = 0.0f; //sum of outcomes
+	};
+	struct Tree {
+		std::vector< Node > nodes;
+		std::mt19937 mt;
+		uint32_t rollouts = 0;
+	};
+	std::vector< Tree > trees; //one per worker
+	uint32_t decisions = 0; //(for seeding)
+
+	void grow(Tree &tree, GameState const &root, std::chrono::steady_clock::time_point deadline, uint32_t iterations) const;
+	float outcome(GameState const &state) const;
+	void play(GameState &state, uint32_t action, uint32_t ticks) const;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+//What game clients (or the loadgen tool) and the headless server say to each other over UDP.
+// The server runs its matches in shards, each listening on its own port: match m lives
+// on port (base port + m % shards). A client sends a ClientPacket to that port every
+// frame or so; the first one from an address claims that player of that match. The
+// server runs the match and sends the state back to both players 60 times a second.
+
+struct ClientPacket {
+	char magic[4] = {'s', 'c', 'l', '0'};
+	uint32_t match = 0;
+	uint32_t sequence = 0; //increases with every packet (echoed back, for measuring round trips)
+	uint8_t player = 0; //0 or 1
+	uint8_t input = 0; //held controls, packed like player 0 in pack_inputs (Replay.hpp)
+	uint16_t padding = 0;
+};
+static_assert(sizeof(ClientPacket) == 16, "Client packet should be packed");
+
+struct ServerPacket {
+	char magic[4] = {'s', 's', 'v', '0'};
+	uint32_t match = 0;
+	uint32_t tick = 0; //of the match
+	uint32_t ack = 0; //newest 'sequence' heard from this client
+	float paddle_x[2] = {0.0f, 0.0f};
+	float paddle_y[2] = {0.0f, 0.0f};
+	float paddle_angle[2] = {0.0f, 0.0f};
+	float ball_x = 0.0f, ball_y = 0.0f;
+	float ball_vx = 0.0f, ball_vy = 0.0f;
+	int32_t winner = -1;
+};
+static_assert(sizeof(ServerPacket) == 60, "Server packet should be packed");
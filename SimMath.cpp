@@ -0,0 +1,25 @@
+#include "SimMath.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+void sim_sincos(float angle, float *s_, float *c_) {
+	assert(s_ && c_);
+	//nearest multiple of pi/2, taken off in three parts (the first two exact in float):
+	float j = std::floor(angle * 0.636619772f + 0.5f);
+	float x = ((angle - j * 1.5703125f) - j * 4.837512969970703125e-4f) - j * 7.54978995489188216e-8f;
+	int32_t quadrant = int32_t(j) & 3;
+
+	//minimax polynomials on [-pi/4, pi/4] (from Cephes' sinf and cosf):
+	float z = x * x;
+	float s = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * x + x;
+	float c = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+
+	switch (quadrant) {
+		case 0: *s_ = s; *c_ = c; break;
+		case 1: *s_ = c; *c_ = -s; break;
+		case 2: *s_ = -s; *c_ = -c; break;
+		default: *s_ = -c; *c_ = s; break;
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cfloat>
+
+//Math for the rules that comes out bit-identical on every platform, compiler, and
+// optimisation level, so lockstep and rollback peers (and replays played elsewhere)
+// stay in sync. IEEE-754 single precision +, -, *, / and sqrt are exactly rounded
+// everywhere; library sin/cos are not, so the rules use the versions here, which are
+// built from those operations alone. That also needs the compiler to leave float
+// expressions as written: no fused multiply-add (-ffp-contract=off, see Jamfile) and
+// no -ffast-math. Pick the fixed-point route if this ever has to run on hardware
+// without IEEE floats; for now strict floats are cheaper and keep the rules readable.
+
+//x87 keeps intermediates in 80 bits, which rounds differently:
+static_assert(FLT_EVAL_METHOD == 0, "the rules need floats evaluated as floats (use SSE2)");
+
+//sine and cosine of 'angle' (radians; accurate to a few ulp within a few turns of zero):
+void sim_sincos(float angle, float *s, float *c);
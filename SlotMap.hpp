@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cassert>
+#include <cstdint>
+
+//Values kept packed in one array (so going over all of them touches only contiguous
+// memory), named by Handles that stay good as the array changes: a handle names a
+// slot, and the slot knows where its value is now. Adding and removing are O(1) --
+// removing moves the last value into the hole -- and each slot counts how many times
+// it has been freed, so a handle to a removed value is caught rather than quietly
+// naming whatever took its slot.
+//
+//Values move when others are removed (or when the array grows), so hold on to handles,
+// not pointers. T needs to be default-constructible and movable.
+
+template< typename T >
+struct SlotMap {
+	struct Handle {
+		uint32_t slot = -1U;
+		uint32_t generation = 0;
+		bool operator==(Handle const &other) const { return slot == other.slot && generation == other.generation; }
+		bool operator!=(Handle const &other) const { return !(*this == other); }
+	};
+
+	//add a default-constructed value:
+	Handle add() {
+		Handle handle;
+		if (!free_slots.empty()) {
+			handle.slot = free_slots.back();
+			free_slots.pop_back();
+		} else {
+			handle.slot = uint32_t(slot_index.size());
+			slot_index.emplace_back(-1U);
+			slot_generation.emplace_back(0);
+		}
+		handle.generation = slot_generation[handle.slot];
+		slot_index[handle.slot] = uint32_t(values.size());
+		values.emplace_back();
+		value_slot.emplace_back(handle.slot);
+		return handle;
+	}
+
+	void remove(Handle handle) {
+		assert(contains(handle));
+		uint32_t index = slot_index[handle.slot];
+		uint32_t last = uint32_t(values.size()) - 1;
+		if (index != last) {
+			values[index] = std::move(values[last]);
+			value_slot[index] = value_slot[last];
+			slot_index[value_slot[index]] = index;
+		}
+		values.pop_back();
+		value_slot.pop_back();
+		slot_index[handle.slot] = -1U;
+		slot_generation[handle.slot] += 1;
+		free_slots.emplace_back(handle.slot);
+	}
+
+	bool contains(Handle handle) const {
+		return handle.slot < slot_index.size() && slot_generation[handle.slot] == handle.generation;
+	}
+	//(only for handles that name a value)
+	T &operator[](Handle handle) {
+		assert(contains(handle));
+		return values[slot_index[handle.slot]];
+	}
+	T const &operator[](Handle handle) const {
+		assert(contains(handle));
+		return values[slot_index[handle.slot]];
+	}
+
+	//every value, packed (in no particular order):
+	typename std::vector< T >::iterator begin() { return values.begin(); }
+	typename std::vector< T >::iterator end() { return values.end(); }
+	typename std::vector< T >::const_iterator begin() const { return values.begin(); }
+	typename std::vector< T >::const_iterator end() const { return values.end(); }
+	uint32_t size() const { return uint32_t(values.size()); }
+	bool empty() const { return values.empty(); }
+
+private:
+	std::vector< T > values;
+	std::vector< uint32_t > value_slot; //slot of each value
+	std::vector< uint32_t > slot_index; //index of each slot's value (-1U when free)
+	std::vector< uint32_t > slot_generation; //bumped whenever a slot is freed
+	std::vector< uint32_t > free_slots;
+};
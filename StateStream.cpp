@@ -0,0 +1,278 @@
+#include "StateStream.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+#include <cmath>
+
+constexpr float StreamFrame::PositionStep;
+constexpr uint32_t StreamFrame::AngleBits;
+constexpr uint32_t StreamFrame::AngleSteps;
+constexpr uint32_t StreamEncoder::History;
+
+namespace {
+
+const uint32_t DeltaWidths[4] = {4, 8, 13, 32};
+const uint32_t MaxBalls = 1 << 16; //(more than this in a packet is taken as garbage)
+static_assert(StreamEncoder::History <= 256, "baseline distance is sent in 8 bits");
+
+uint32_t low_bits(uint32_t width) {
+	return (width >= 32 ? 0xffffffffU : (1U << width) - 1);
+}
+
+struct BitWriter {
+	explicit BitWriter(std::vector< uint8_t > &out_) : out(out_) { }
+	std::vector< uint8_t > &out;
+	uint64_t bits = 0;
+	uint32_t count = 0;
+
+	void write(uint32_t value, uint32_t width) {
+		bits |= uint64_t(value & low_bits(width)) << count;
+		count += width;
+		while (count >= 8) {
+			out.emplace_back(uint8_t(bits));
+			bits >>= 8;
+			count -= 8;
+		}
+	}
+	void flush() {
+		if (count) out.emplace_back(uint8_t(bits));
+		bits = 0;
+		count = 0;
+	}
+	void delta(int32_t value) {
+		uint32_t zigzag = (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+		if (zigzag == 0) {
+			write(0, 1);
+			return;
+		}
+		uint32_t size = 0;
+		while (zigzag > low_bits(DeltaWidths[size])) ++size;
+		write(1 | (size << 1), 3);
+		write(zigzag, DeltaWidths[size]);
+	}
+};
+
+struct BitReader {
+	BitReader(uint8_t const *data_, size_t size_) : data(data_), size(size_) { }
+	uint8_t const *data;
+	size_t size;
+	size_t at = 0;
+	uint64_t bits = 0;
+	uint32_t count = 0;
+
+	uint32_t read(uint32_t width) {
+		while (count < width) {
+			if (at == size) throw std::runtime_error("Stream packet ends early");
+			bits |= uint64_t(data[at++]) << count;
+			count += 8;
+		}
+		uint32_t value = uint32_t(bits) & low_bits(width);
+		bits >>= width;
+		count -= width;
+		return value;
+	}
+	int32_t delta() {
+		if (read(1) == 0) return 0;
+		uint32_t zigzag = read(DeltaWidths[read(2)]);
+		return int32_t(zigzag >> 1) ^ -int32_t(zigzag & 1);
+	}
+};
+
+//(differences wrap around, so garbage in a packet can't overflow anything)
+int32_t difference(int32_t value, int32_t baseline) {
+	return int32_t(uint32_t(value) - uint32_t(baseline));
+}
+int32_t undo_difference(int32_t delta, int32_t baseline) {
+	return int32_t(uint32_t(baseline) + uint32_t(delta));
+}
+//angles take the short way around:
+int32_t angle_difference(uint32_t value, uint32_t baseline) {
+	int32_t delta = int32_t((value - baseline) & (StreamFrame::AngleSteps - 1));
+	return (delta >= int32_t(StreamFrame::AngleSteps / 2) ? delta - int32_t(StreamFrame::AngleSteps) : delta);
+}
+
+int32_t quantize_position(float value) {
+	float steps = std::round(value / StreamFrame::PositionStep);
+	return int32_t(std::max(-1.0e9f, std::min(1.0e9f, steps)));
+}
+
+} //namespace
+
+bool StreamFrame::operator==(StreamFrame const &other) const {
+	return tick == other.tick && winner == other.winner
+		&& std::equal(paddle_x, paddle_x + 2, other.paddle_x)
+		&& std::equal(paddle_y, paddle_y + 2, other.paddle_y)
+		&& std::equal(paddle_angle, paddle_angle + 2, other.paddle_angle)
+		&& ball_x == other.ball_x && ball_y == other.ball_y && ball_z == other.ball_z;
+}
+
+StreamFrame quantize(uint32_t tick, GameState const &state, Balls const &balls) {
+	StreamFrame frame;
+	frame.tick = tick;
+	frame.winner = state.winner;
+	for (uint32_t i = 0; i < 2; ++i) {
+		GameState::Paddle const &paddle = state.paddles[i];
+		frame.paddle_x[i] = quantize_position(paddle.position.x);
+		frame.paddle_y[i] = quantize_position(paddle.position.y);
+		double turns = paddle.angle / glm::two_pi< double >();
+		frame.paddle_angle[i] = uint32_t(int64_t(std::floor((turns - std::floor(turns)) * StreamFrame::AngleSteps + 0.5))) & (StreamFrame::AngleSteps - 1);
+	}
+	uint32_t count = 1 + balls.size();
+	frame.ball_x.resize(count);
+	frame.ball_y.resize(count);
+	frame.ball_z.resize(count);
+	frame.ball_x[0] = quantize_position(state.ball.position.x);
+	frame.ball_y[0] = quantize_position(state.ball.position.y);
+	frame.ball_z[0] = quantize_position(state.ball.position.z);
+	for (uint32_t i = 0; i < balls.size(); ++i) {
+		frame.ball_x[i + 1] = quantize_position(balls.x[i]);
+		frame.ball_y[i + 1] = quantize_position(balls.y[i]);
+		frame.ball_z[i + 1] = quantize_position(balls.z[i]);
+	}
+	return frame;
+}
+
+void dequantize(StreamFrame const &frame, GameState *state, Balls *balls) {
+	assert(state);
+	assert(balls);
+	state->winner = frame.winner;
+	for (uint32_t i = 0; i < 2; ++i) {
+		state->paddles[i].position.x = frame.paddle_x[i] * StreamFrame::PositionStep;
+		state->paddles[i].position.y = frame.paddle_y[i] * StreamFrame::PositionStep;
+		state->paddles[i].angle = float(frame.paddle_angle[i] * (glm::two_pi< double >() / StreamFrame::AngleSteps));
+	}
+	balls->clear();
+	if (frame.ball_x.empty()) return;
+	state->ball.position = glm::vec3(frame.ball_x[0], frame.ball_y[0], frame.ball_z[0]) * StreamFrame::PositionStep;
+	state->ball.velocity = glm::vec3(0.0f);
+	for (uint32_t i = 1; i < frame.ball_x.size(); ++i) {
+		balls->add(glm::vec3(frame.ball_x[i], frame.ball_y[i], frame.ball_z[i]) * StreamFrame::PositionStep);
+	}
+}
+
+uint32_t pack_rotation(glm::quat const &rotation) {
+	float q[4] = {rotation.x, rotation.y, rotation.z, rotation.w};
+	uint32_t largest = 0;
+	for (uint32_t i = 1; i < 4; ++i) {
+		if (std::abs(q[i]) > std::abs(q[largest])) largest = i;
+	}
+	//(q and -q are the same rotation, so make the dropped one positive)
+	float sign = (q[largest] < 0.0f ? -1.0f : 1.0f);
+	uint32_t bits = largest << 30;
+	uint32_t shift = 20;
+	for (uint32_t i = 0; i < 4; ++i) {
+		if (i == largest) continue;
+		float unit = std::max(-1.0f, std::min(1.0f, sign * q[i] * glm::root_two< float >()));
+		bits |= uint32_t(std::round((unit * 0.5f + 0.5f) * 1023.0f)) << shift;
+		shift -= 10;
+	}
+	return bits;
+}
+
+glm::quat unpack_rotation(uint32_t bits) {
+	uint32_t largest = bits >> 30;
+	float q[4];
+	float sum2 = 0.0f;
+	uint32_t shift = 20;
+	for (uint32_t i = 0; i < 4; ++i) {
+		if (i == largest) continue;
+		float unit = ((bits >> shift) & 1023) / 1023.0f * 2.0f - 1.0f;
+		q[i] = unit * glm::one_over_root_two< float >();
+		sum2 += q[i] * q[i];
+		shift -= 10;
+	}
+	q[largest] = std::sqrt(std::max(0.0f, 1.0f - sum2));
+	return glm::normalize(glm::quat(q[3], q[0], q[1], q[2]));
+}
+
+//---------------------------
+
+void StreamEncoder::encode(StreamFrame const &frame, std::vector< uint8_t > *out) {
+	assert(out);
+	static const StreamFrame empty;
+	StreamFrame const *baseline = &empty;
+	uint32_t back = 0;
+	if (have_ack && frame.tick > acked && frame.tick - acked < History) {
+		uint32_t slot = acked % History;
+		if (kept[slot] && sent[slot].tick == acked) {
+			baseline = &sent[slot];
+			back = frame.tick - acked;
+		}
+	}
+
+	BitWriter bits(*out);
+	bits.write(frame.tick, 32);
+	bits.write(back, 8);
+	bits.write(uint32_t(frame.winner + 1), 2);
+	uint32_t count = uint32_t(frame.ball_x.size());
+	uint32_t baseline_count = uint32_t(baseline->ball_x.size());
+	bits.delta(difference(count, baseline_count));
+	for (uint32_t i = 0; i < 2; ++i) {
+		bits.delta(difference(frame.paddle_x[i], baseline->paddle_x[i]));
+		bits.delta(difference(frame.paddle_y[i], baseline->paddle_y[i]));
+		bits.delta(angle_difference(frame.paddle_angle[i], baseline->paddle_angle[i]));
+	}
+	for (uint32_t i = 0; i < count; ++i) {
+		bool known = (i < baseline_count);
+		bits.delta(difference(frame.ball_x[i], known ? baseline->ball_x[i] : 0));
+		bits.delta(difference(frame.ball_y[i], known ? baseline->ball_y[i] : 0));
+		bits.delta(difference(frame.ball_z[i], known ? baseline->ball_z[i] : 0));
+	}
+	bits.flush();
+
+	sent[frame.tick % History] = frame;
+	kept[frame.tick % History] = true;
+}
+
+void StreamEncoder::acknowledge(uint32_t tick) {
+	if (!kept[tick % History] || sent[tick % History].tick != tick) return; //(not sent, or no longer kept)
+	if (have_ack && tick <= acked) return;
+	have_ack = true;
+	acked = tick;
+}
+
+bool StreamDecoder::decode(uint8_t const *data, size_t size, StreamFrame *frame_) {
+	assert(frame_);
+	static const StreamFrame empty;
+	BitReader bits(data, size);
+	uint32_t tick = bits.read(32);
+	uint32_t back = bits.read(8);
+	StreamFrame const *baseline = &empty;
+	if (back != 0) {
+		uint32_t slot = (tick - back) % StreamEncoder::History;
+		if (!valid[slot] || received[slot].tick != tick - back) return false;
+		baseline = &received[slot];
+	}
+
+	StreamFrame frame;
+	frame.tick = tick;
+	frame.winner = int32_t(bits.read(2)) - 1;
+	if (frame.winner > 1) throw std::runtime_error("Stream packet has a bad winner");
+	uint32_t baseline_count = uint32_t(baseline->ball_x.size());
+	uint32_t count = uint32_t(undo_difference(bits.delta(), baseline_count));
+	if (count > MaxBalls) throw std::runtime_error("Stream packet has too many balls");
+	for (uint32_t i = 0; i < 2; ++i) {
+		frame.paddle_x[i] = undo_difference(bits.delta(), baseline->paddle_x[i]);
+		frame.paddle_y[i] = undo_difference(bits.delta(), baseline->paddle_y[i]);
+		frame.paddle_angle[i] = uint32_t(undo_difference(bits.delta(), baseline->paddle_angle[i])) & (StreamFrame::AngleSteps - 1);
+	}
+	frame.ball_x.resize(count);
+	frame.ball_y.resize(count);
+	frame.ball_z.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		bool known = (i < baseline_count);
+		frame.ball_x[i] = undo_difference(bits.delta(), known ? baseline->ball_x[i] : 0);
+		frame.ball_y[i] = undo_difference(bits.delta(), known ? baseline->ball_y[i] : 0);
+		frame.ball_z[i] = undo_difference(bits.delta(), known ? baseline->ball_z[i] : 0);
+	}
+	if (bits.at != size) throw std::runtime_error("Stream packet has data past the end");
+
+	uint32_t slot = tick % StreamEncoder::History;
+	received[slot] = frame;
+	valid[slot] = true;
+	*frame_ = std::move(frame);
+	return true;
+}
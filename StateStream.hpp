@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Game.hpp"
+#include "Balls.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//A compact stream of match states for spectators (and for replays a viewer can play
+// without running the rules). Each StreamFrame is what a spectator draws, quantised:
+// positions on a grid of PositionStep units, spin stuff as a single angle each (they only
+// ever turn about z). A frame is sent as the difference from a baseline frame the
+// receiver has acknowledged -- mostly small numbers, or nothing for things that didn't
+// move -- packed into as few bits as that takes. With no usable baseline, it goes in full.
+//
+//A packet is:
+//  tick (32 bits), baseline distance (8 bits: tick - baseline tick, 0 for none)
+//  winner + 1 (2 bits), ball count (delta)
+//  per spin stuff: x, y (delta), angle (delta, modulo AngleSteps)
+//  per ball: x, y, z (delta; balls past the baseline's count are sent against zero)
+//Every delta is a 0 bit if zero, else a 1 bit, 2 bits picking a width from DeltaWidths,
+// and the value zigzag-coded in that many bits.
+
+struct StreamFrame {
+	uint32_t tick = 0;
+	int32_t winner = -1;
+	int32_t paddle_x[2] = {0, 0};
+	int32_t paddle_y[2] = {0, 0};
+	uint32_t paddle_angle[2] = {0, 0}; //in [0, AngleSteps)
+	std::vector< int32_t > ball_x, ball_y, ball_z; //the match ball, then any extra balls
+
+	static constexpr float PositionStep = 1.0f / 1024.0f; //(about a millimetre)
+	static constexpr uint32_t AngleBits = 12;
+	static constexpr uint32_t AngleSteps = 1 << AngleBits;
+
+	bool operator==(StreamFrame const &other) const;
+};
+
+//quantise the drawable parts of a match:
+StreamFrame quantize(uint32_t tick, GameState const &state, Balls const &balls);
+//and back (fills the positions, angles, and winner in 'state'; 'balls' get zero velocity):
+void dequantize(StreamFrame const &frame, GameState *state, Balls *balls);
+
+//"smallest three" rotation packing, for Scene transforms that turn freely:
+// the largest component of a unit quaternion is implied by the other three, which are
+// each within +/-sqrt(1/2), so 2 bits (which one was dropped) + 3 x 10 bits fit in 32:
+uint32_t pack_rotation(glm::quat const &rotation);
+glm::quat unpack_rotation(uint32_t bits);
+
+//Sender's end, one per receiver:
+struct StreamEncoder {
+	//append the packet for 'frame' (ticks should increase) to 'out':
+	void encode(StreamFrame const &frame, std::vector< uint8_t > *out);
+	//the receiver has 'tick' (later frames are sent against it while it is in the history):
+	void acknowledge(uint32_t tick);
+
+	static constexpr uint32_t History = 256; //frames from this many ticks back are kept as possible baselines
+
+private:
+	std::vector< StreamFrame > sent = std::vector< StreamFrame >(History); //(by tick % History)
+	std::vector< bool > kept = std::vector< bool >(History, false);
+	bool have_ack = false;
+	uint32_t acked = 0;
+};
+
+//Receiver's end:
+struct StreamDecoder {
+	//read one packet; returns false if its baseline is no longer (or not yet) known,
+	// throws on malformed data. Acknowledge frame->tick to the sender after a true return:
+	bool decode(uint8_t const *data, size_t size, StreamFrame *frame);
+
+private:
+	std::vector< StreamFrame > received = std::vector< StreamFrame >(StreamEncoder::History);
+	std::vector< bool > valid = std::vector< bool >(StreamEncoder::History, false);
+};
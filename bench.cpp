@@ -0,0 +1,1271 @@
+//Headless benchmarks for the game library.
+// usage: bench [name ...]   (no names runs everything)
+
+#include "Game.hpp"
+#include "Balls.hpp"
+#include "BallGrid.hpp"
+#include "FreeForAll.hpp"
+#include "Rollback.hpp"
+#include "Search.hpp"
+#include "Bot.hpp"
+#include "JobPool.hpp"
+#include "BallPath.hpp"
+#include "StateStream.hpp"
+#include "SimMath.hpp"
+#include "Replay.hpp"
+#include "Scene.hpp"
+#include "SceneNodes.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/closest_point.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <functional>
+#include <list>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+//seconds since 'start':
+static double since(std::chrono::high_resolution_clock::time_point const &start) {
+	return std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//random held keys, changed every so often (roughly what two people mashing look like):
+static void random_inputs(std::mt19937 &mt, GameInputs *inputs_) {
+	GameInputs &inputs = *inputs_;
+	std::uniform_int_distribution< uint32_t > bits(0, 31);
+	for (auto &player : inputs.players) {
+		uint32_t b = bits(mt);
+		player.left = (b & 1);
+		player.right = (b & 2);
+		player.up = (b & 4);
+		player.down = (b & 8);
+		player.toggle = (b & 16);
+	}
+}
+
+//---------------------------
+
+static void bench_step() {
+	const uint32_t Ticks = 2000000;
+
+	std::mt19937 mt(0xfeedf00d);
+	Arena arena;
+	GameState state;
+	GameInputs inputs;
+	uint32_t matches = 0;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t tick = 0; tick < Ticks; ++tick) {
+		if (tick % 80 == 0) random_inputs(mt, &inputs);
+		step(arena, state, inputs, TickElapsed);
+		if (state.winner != -1) {
+			state = GameState();
+			++matches;
+		}
+	}
+	double seconds = since(start);
+
+	std::cout << "step: " << Ticks << " ticks in " << seconds << "s = "
+		<< (Ticks / seconds) << " ticks/sec (" << matches << " matches finished)" << std::endl;
+}
+
+//---------------------------
+
+//one spin stuff vs ball encounter over a (deliberately long) update:
+struct Encounter {
+	GameState::Paddle start, end;
+	glm::vec3 ball_position, ball_velocity;
+};
+
+static std::vector< Encounter > random_encounters(uint32_t count, float elapsed) {
+	std::mt19937 mt(0xbadc0ffe);
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	std::vector< Encounter > encounters(count);
+	for (auto &e : encounters) {
+		e.start.position = glm::vec3(0.0f, 0.0f, 0.16f);
+		e.start.angle = 3.14159f * unit(mt);
+		e.start.clockwise = (unit(mt) < 0.0f ? -1.0f : 1.0f);
+		e.end = e.start;
+		e.end.position += 1.2f * elapsed * glm::vec3(unit(mt), unit(mt), 0.0f);
+		e.end.angle += 5.0f * e.start.clockwise * elapsed;
+		e.ball_position = glm::vec3(0.6f * unit(mt), 0.6f * unit(mt), 0.2f);
+		e.ball_velocity = glm::vec3(8.0f * unit(mt), 8.0f * unit(mt), 0.0f);
+	}
+	return encounters;
+}
+
+//the discrete test at 'steps' evenly spaced times during the update:
+static bool substep_collide(Encounter const &e, uint32_t steps, float elapsed) {
+	for (uint32_t s = 1; s <= steps; ++s) {
+		float amt = float(s) / float(steps);
+		GameState::Paddle spin = e.start;
+		spin.position = glm::mix(e.start.position, e.end.position, amt);
+		spin.angle = glm::mix(e.start.angle, e.end.angle, amt);
+		if (spin_collide_ball(spin, e.ball_position + (amt * elapsed) * e.ball_velocity)) return true;
+	}
+	return false;
+}
+
+static void bench_swept() {
+	const float Elapsed = 1.0f / 30.0f;
+	std::vector< Encounter > encounters = random_encounters(200000, Elapsed);
+
+	//"ground truth" is the discrete test run very finely:
+	std::vector< bool > truth(encounters.size());
+	uint32_t contacts = 0;
+	for (uint32_t i = 0; i < encounters.size(); ++i) {
+		truth[i] = substep_collide(encounters[i], 1024, Elapsed);
+		if (truth[i]) ++contacts;
+	}
+	std::cout << "swept: " << encounters.size() << " encounters over " << Elapsed << "s, " << contacts << " touch" << std::endl;
+
+	auto report = [&](std::string const &name, std::function< bool(Encounter const &) > const &test) {
+		uint32_t wrong = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < encounters.size(); ++i) {
+			if (test(encounters[i]) != truth[i]) ++wrong;
+		}
+		double seconds = since(start);
+		std::cout << "  " << name << ": " << (seconds / encounters.size() * 1e9) << " ns/test, "
+			<< wrong << " disagree with ground truth" << std::endl;
+	};
+
+	report("swept", [&](Encounter const &e) {
+		float toi;
+		return spin_sweep_ball(e.start.position, e.end.position, e.start.angle, 5.0f * e.start.clockwise, e.ball_position, e.ball_velocity, Elapsed, &toi);
+	});
+	for (uint32_t steps : {1, 4, 16, 64}) {
+		report("substep x" + std::to_string(steps), [&](Encounter const &e) {
+			return substep_collide(e, steps, Elapsed);
+		});
+	}
+}
+
+//---------------------------
+
+static void bench_balls() {
+	std::cout << "balls: multi-ball ticks (" << (1.0f / TickElapsed) << "Hz rules)" << std::endl;
+	for (uint32_t count : {1, 100, 1000, 10000, 100000}) {
+		std::mt19937 mt(0xba11);
+		std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+		Arena arena;
+		GameState state;
+		Balls balls;
+		for (uint32_t i = 1; i < count; ++i) {
+			balls.add(glm::vec3(2.8f * unit(mt), 1.4f * unit(mt), 0.2f), glm::vec3(2.0f * unit(mt), 2.0f * unit(mt), 0.0f));
+		}
+		BallGrid grid(-arena.half_size, arena.half_size);
+		GameInputs inputs;
+		uint32_t ticks = std::max(50U, 2000000U / count);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t tick = 0; tick < ticks; ++tick) {
+			if (tick % 80 == 0) random_inputs(mt, &inputs);
+			step(arena, state, balls, grid, inputs, TickElapsed);
+		}
+		double seconds = since(start);
+
+		std::cout << "  " << count << " balls: " << (ticks / seconds) << " ticks/sec, "
+			<< (seconds / ticks * 1e3) << " ms/tick, "
+			<< (seconds / (double(ticks) * count) * 1e9) << " ns/ball" << std::endl;
+	}
+}
+
+//---------------------------
+
+//every touching pair the slow way (counts only; doesn't bounce anything):
+static uint32_t count_touching(BallArrays const &balls) {
+	const float Diameter = 2.0f * BallRadius;
+	uint32_t touching = 0;
+	for (uint32_t a = 0; a < balls.count; ++a) {
+		for (uint32_t b = a + 1; b < balls.count; ++b) {
+			float dx = balls.x[b] - balls.x[a];
+			float dy = balls.y[b] - balls.y[a];
+			if (dx * dx + dy * dy < Diameter * Diameter) ++touching;
+		}
+	}
+	return touching;
+}
+
+static void bench_grid() {
+	std::cout << "grid: ball-ball collisions (arena grows with the ball count; as crowded as 100 balls on the field)" << std::endl;
+	for (uint32_t count : {100, 1000, 10000, 100000}) {
+		glm::vec2 half_size = Arena().half_size * std::sqrt(count / 100.0f);
+		std::mt19937 mt(0x6e1d);
+		std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+		Balls balls;
+		for (uint32_t i = 0; i < count; ++i) {
+			balls.add(glm::vec3(half_size.x * unit(mt), half_size.y * unit(mt), 0.2f), glm::vec3(2.0f * unit(mt), 2.0f * unit(mt), 0.0f));
+		}
+		BallArrays arrays = balls.arrays();
+		BallGrid grid(-half_size, half_size);
+
+		//naive pair count first (before the grid pushes anything apart):
+		uint32_t naive = 0;
+		double naive_seconds = 0.0;
+		if (count <= 10000) {
+			auto start = std::chrono::high_resolution_clock::now();
+			naive = count_touching(arrays);
+			naive_seconds = since(start);
+		}
+
+		uint32_t reps = std::max(20U, 2000000U / count);
+		uint32_t first = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t rep = 0; rep < reps; ++rep) {
+			uint32_t touching = collide_balls(grid, &arrays, 1);
+			if (rep == 0) first = touching;
+		}
+		double seconds = since(start);
+
+		std::cout << "  " << count << " balls: grid " << (seconds / reps * 1e3) << " ms/tick ("
+			<< (seconds / (double(reps) * count) * 1e9) << " ns/ball), " << first << " touching pairs";
+		if (count <= 10000) {
+			std::cout << "; all pairs " << (naive_seconds * 1e3) << " ms, " << naive << " touching pairs";
+		}
+		std::cout << std::endl;
+	}
+}
+
+//---------------------------
+
+static void bench_simd() {
+	const uint32_t Count = 4096;
+	const uint32_t Rounds = 2000;
+
+	std::mt19937 mt(0x51d);
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	Balls balls;
+	for (uint32_t i = 0; i < Count; ++i) {
+		//mostly near the spin stuff, so both answers come up:
+		balls.add(glm::vec3(0.8f * unit(mt), 0.8f * unit(mt), 0.2f), glm::vec3(3.0f * unit(mt), 3.0f * unit(mt), 0.0f));
+	}
+	BallArrays arrays = balls.arrays();
+
+	std::vector< SpinMotion > spins(64);
+	for (auto &spin : spins) {
+		spin.start = glm::vec3(0.1f * unit(mt), 0.1f * unit(mt), 0.16f);
+		spin.end = spin.start + 1.2f * TickElapsed * glm::vec3(unit(mt), unit(mt), 0.0f);
+		spin.angle_start = 3.14159f * unit(mt);
+		spin.spin_rate = (unit(mt) < 0.0f ? -5.0f : 5.0f);
+	}
+
+	//decisions must match bit for bit:
+	std::vector< uint8_t > simd(Count), scalar(Count);
+	uint32_t flagged = 0;
+	for (auto const &spin : spins) {
+		spin_ball_candidates(spin, arrays, TickElapsed, simd.data());
+		spin_ball_candidates_scalar(spin, arrays, TickElapsed, scalar.data());
+		if (simd != scalar) {
+			std::cerr << "simd: ERROR: " << spin_ball_candidates_isa() << " and scalar candidates differ!" << std::endl;
+			exit(1);
+		}
+		for (auto c : simd) flagged += c;
+	}
+	std::cout << "simd: " << spin_ball_candidates_isa() << " matches scalar on " << (spins.size() * Count)
+		<< " tests (" << flagged << " flagged)" << std::endl;
+
+	auto report = [&](std::string const &name, std::function< void(SpinMotion const &) > const &test) {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t round = 0; round < Rounds; ++round) {
+			test(spins[round % spins.size()]);
+		}
+		double seconds = since(start);
+		std::cout << "  " << name << ": " << (seconds / (double(Rounds) * Count) * 1e9) << " ns/ball" << std::endl;
+	};
+
+	uint32_t sink = 0;
+	report("spin_collide_ball", [&](SpinMotion const &spin) {
+		GameState::Paddle paddle;
+		paddle.position = spin.start;
+		paddle.angle = spin.angle_start;
+		for (uint32_t i = 0; i < Count; ++i) {
+			sink += spin_collide_ball(paddle, glm::vec3(arrays.x[i], arrays.y[i], arrays.z[i]));
+		}
+	});
+	report("scalar", [&](SpinMotion const &spin) {
+		spin_ball_candidates_scalar(spin, arrays, TickElapsed, scalar.data());
+		sink += scalar[0];
+	});
+	report(spin_ball_candidates_isa(), [&](SpinMotion const &spin) {
+		spin_ball_candidates(spin, arrays, TickElapsed, simd.data());
+		sink += simd[0];
+	});
+	if (sink == 0xffffffff) std::cout << "(unlikely)" << std::endl; //keep 'sink' live
+}
+
+//---------------------------
+
+//the four-line test spin_collide_ball used before it became an exact box test:
+static bool legacy_spin_collide_ball(GameState::Paddle const &spin, glm::vec3 const &ball_position) {
+	glm::quat rotation = glm::angleAxis(spin.angle, glm::vec3(0.0f, 0.0f, 1.0f));
+	glm::vec3 n = glm::normalize(glm::mat4_cast(rotation) * glm::vec4(-1.0f, 0.0f, 0.0f, 1.0f));
+	glm::vec3 v = glm::vec3(-1.0f * n.y, n.x, 0.0f);
+	glm::vec3 p1 = spin.position + (0.005f * n);
+	glm::vec3 p2 = p1 + (0.32f * v);
+	glm::vec3 p3 = p2 - (0.01f * n);
+	glm::vec3 p4 = spin.position - (0.005f * n);
+	float d12 = distance(ball_position, closestPointOnLine(ball_position, p1, p2));
+	float d34 = distance(ball_position, closestPointOnLine(ball_position, p3, p4));
+	float d14 = distance(ball_position, closestPointOnLine(ball_position, p1, p4));
+	float d23 = distance(ball_position, closestPointOnLine(ball_position, p2, p3));
+	return (d12 + d34 <= 0.2 && d14 + d23 <= 3.0);
+}
+
+static void bench_collider() {
+	const uint32_t Count = 1000000;
+
+	std::mt19937 mt(0xc011);
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	std::vector< GameState::Paddle > spins(Count);
+	std::vector< glm::vec3 > balls(Count);
+	for (uint32_t i = 0; i < Count; ++i) {
+		spins[i].position = glm::vec3(0.0f, 0.0f, 0.16f);
+		spins[i].angle = 3.14159f * unit(mt);
+		balls[i] = glm::vec3(0.4f * unit(mt), 0.4f * unit(mt), 0.2f);
+	}
+
+	std::vector< uint8_t > legacy(Count), exact(Count);
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < Count; ++i) {
+		legacy[i] = legacy_spin_collide_ball(spins[i], balls[i]);
+	}
+	double legacy_seconds = since(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < Count; ++i) {
+		exact[i] = spin_collide_ball(spins[i], balls[i]);
+	}
+	double exact_seconds = since(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	float depth = 0.0f;
+	for (uint32_t i = 0; i < Count; ++i) {
+		SpinContact contact;
+		if (spin_contact_ball(spins[i].position, spins[i].angle, balls[i], &contact)) depth += contact.depth;
+	}
+	double contact_seconds = since(start);
+
+	uint32_t legacy_hits = 0, exact_hits = 0, both = 0;
+	for (uint32_t i = 0; i < Count; ++i) {
+		legacy_hits += legacy[i];
+		exact_hits += exact[i];
+		both += (legacy[i] && exact[i]);
+	}
+	std::cout << "collider: " << Count << " spin stuff / ball pairs" << std::endl;
+	std::cout << "  four lines: " << (legacy_seconds / Count * 1e9) << " ns/test, " << legacy_hits << " hits" << std::endl;
+	std::cout << "  box: " << (exact_seconds / Count * 1e9) << " ns/test, " << exact_hits << " hits (" << both << " in common)" << std::endl;
+	std::cout << "  box + normal/depth: " << (contact_seconds / Count * 1e9) << " ns/test (mean depth " << (depth / std::max(1U, exact_hits)) << ")" << std::endl;
+	//(the box is a gameplay change, not just a speedup: it counts more of these pairs as hits)
+	std::cout << "  box vs four lines: " << (legacy_seconds / exact_seconds) << "x the speed, "
+		<< ((double(exact_hits) / std::max(1U, legacy_hits) - 1.0) * 100.0) << "% more hits ("
+		<< (exact_hits - both) << " only the box finds, " << (legacy_hits - both) << " only the four lines do)" << std::endl;
+}
+
+//---------------------------
+
+//every overlapping pair the slow way, for checking (and timing against) the sweep:
+static std::vector< Broadphase::Pair > all_pairs(Broadphase const &broadphase) {
+	std::vector< Broadphase::Pair > pairs;
+	auto const &proxies = broadphase.proxies;
+	for (uint32_t a = 0; a < proxies.size(); ++a) {
+		for (uint32_t b = a + 1; b < proxies.size(); ++b) {
+			if (!broadphase_tests(proxies[a].kind, proxies[b].kind)) continue;
+			if (proxies[a].max.x < proxies[b].min.x || proxies[b].max.x < proxies[a].min.x) continue;
+			if (proxies[a].max.y < proxies[b].min.y || proxies[b].max.y < proxies[a].min.y) continue;
+			Broadphase::Pair pair;
+			pair.a = (proxies[a].kind <= proxies[b].kind ? a : b);
+			pair.b = (proxies[a].kind <= proxies[b].kind ? b : a);
+			pairs.emplace_back(pair);
+		}
+	}
+	return pairs;
+}
+
+static void bench_ffa() {
+	std::cout << "ffa: free-for-all ticks (sweep-and-prune broadphase; 2 balls per player)" << std::endl;
+	for (uint32_t players : {16, 64, 256, 1024, 4096}) {
+		std::mt19937 mt(0xf4a11);
+		FreeForAll ffa(players);
+		std::vector< PlayerInput > inputs(players);
+		uint32_t ticks = std::max(50U, 400000U / players);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t tick = 0; tick < ticks; ++tick) {
+			if (tick % 80 == 0) {
+				for (uint32_t i = 0; i < players; i += 2) {
+					GameInputs two;
+					random_inputs(mt, &two);
+					inputs[i] = two.players[0];
+					if (i + 1 < players) inputs[i+1] = two.players[1];
+				}
+			}
+			step(ffa, inputs, TickElapsed);
+		}
+		double seconds = since(start);
+
+		//time the broadphase alone, against testing every pair:
+		auto sap_start = std::chrono::high_resolution_clock::now();
+		ffa.broadphase.update();
+		double sap_seconds = since(sap_start);
+		auto brute_start = std::chrono::high_resolution_clock::now();
+		std::vector< Broadphase::Pair > brute = all_pairs(ffa.broadphase);
+		double brute_seconds = since(brute_start);
+
+		auto pair_less = [](Broadphase::Pair const &x, Broadphase::Pair const &y) {
+			return x.a < y.a || (x.a == y.a && x.b < y.b);
+		};
+		auto pair_equal = [](Broadphase::Pair const &x, Broadphase::Pair const &y) {
+			return x.a == y.a && x.b == y.b;
+		};
+		std::vector< Broadphase::Pair > sap = ffa.broadphase.pairs;
+		std::sort(sap.begin(), sap.end(), pair_less);
+		std::sort(brute.begin(), brute.end(), pair_less);
+		bool same = (sap.size() == brute.size() && std::equal(sap.begin(), sap.end(), brute.begin(), pair_equal));
+
+		std::cout << "  " << players << " players: " << (seconds / ticks * 1e3) << " ms/tick, "
+			<< (seconds / (double(ticks) * players) * 1e9) << " ns/player; broadphase "
+			<< (sap_seconds * 1e6) << " us vs all pairs " << (brute_seconds * 1e6) << " us, "
+			<< sap.size() << " pairs" << (same ? "" : " (MISMATCH)") << std::endl;
+	}
+}
+
+//---------------------------
+
+static void bench_snapshot() {
+	const uint32_t History = 256; //about a second of ticks, as a rollback buffer might keep
+	const uint32_t Rounds = 10000000;
+
+	std::mt19937 mt(0x5a9e);
+	Arena arena;
+	GameState state;
+	GameInputs inputs;
+	for (uint32_t tick = 0; tick < 500; ++tick) { //(somewhere in the middle of a match)
+		if (tick % 80 == 0) random_inputs(mt, &inputs);
+		step(arena, state, inputs, TickElapsed);
+	}
+	std::vector< GameState > history(History);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t round = 0; round < Rounds; ++round) {
+		state.ball.position.x += 1e-6f; //(so every snapshot differs)
+		std::memcpy(&history[round % History], &state, sizeof(GameState));
+	}
+	double snapshot_seconds = since(start);
+
+	float checksum = 0.0f;
+	start = std::chrono::high_resolution_clock::now();
+	for (uint32_t round = 0; round < Rounds; ++round) {
+		std::memcpy(&state, &history[(round * 97) % History], sizeof(GameState));
+		checksum += state.ball.position.x;
+	}
+	double restore_seconds = since(start);
+
+	std::cout << "snapshot: GameState is " << sizeof(GameState) << " bytes; snapshot "
+		<< (snapshot_seconds / Rounds * 1e9) << " ns, restore " << (restore_seconds / Rounds * 1e9)
+		<< " ns (checksum " << checksum << ")" << std::endl;
+
+	//multi-ball: the balls come along as a Balls copy into preallocated storage:
+	for (uint32_t count : {16, 1000}) {
+		std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+		Balls balls;
+		for (uint32_t i = 0; i < count; ++i) {
+			balls.add(glm::vec3(2.8f * unit(mt), 1.4f * unit(mt), 0.2f), glm::vec3(2.0f * unit(mt), 2.0f * unit(mt), 0.0f));
+		}
+		std::vector< Balls > ball_history(History, balls);
+		uint32_t rounds = Rounds / count;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t round = 0; round < rounds; ++round) {
+			balls.x[round % count] += 1e-6f;
+			std::memcpy(&history[round % History], &state, sizeof(GameState));
+			ball_history[round % History] = balls;
+		}
+		snapshot_seconds = since(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t round = 0; round < rounds; ++round) {
+			std::memcpy(&state, &history[(round * 97) % History], sizeof(GameState));
+			balls = ball_history[(round * 97) % History];
+			checksum += balls.x[round % count];
+		}
+		restore_seconds = since(start);
+
+		std::cout << "  with " << count << " more balls: snapshot " << (snapshot_seconds / rounds * 1e9)
+			<< " ns, restore " << (restore_seconds / rounds * 1e9) << " ns (checksum " << checksum << ")" << std::endl;
+	}
+}
+
+//---------------------------
+
+static void bench_rollback() {
+	std::cout << "rollback: restore + re-simulate after a late remote input (worst case: the oldest tick was wrong)" << std::endl;
+	for (uint32_t behind : {4, 16, 64}) {
+		const uint32_t Reps = 20000 / behind;
+		std::mt19937 mt(0x7011);
+		Rollback rollback(Arena(), 0, 2);
+		GameInputs inputs;
+		PlayerInput remote; //what the remote last held (so what gets predicted)
+		uint32_t resimulated = 0;
+		double seconds = 0.0;
+		for (uint32_t rep = 0; rep < Reps; ++rep) {
+			//run ahead of the remote inputs, predicting:
+			while (rollback.tick < rollback.remote_confirmed + behind && rollback.can_advance()) {
+				if (rollback.tick % 80 == 0) random_inputs(mt, &inputs);
+				rollback.advance(inputs.players[0]);
+			}
+			//then hear that the remote did something else the whole time:
+			remote.toggle = !remote.toggle;
+			while (rollback.remote_confirmed < rollback.tick) {
+				rollback.receive_remote(rollback.remote_confirmed, remote);
+			}
+			auto start = std::chrono::high_resolution_clock::now();
+			resimulated += rollback.correct();
+			seconds += since(start);
+		}
+		std::cout << "  " << behind << " ticks behind: " << (seconds / Reps * 1e6) << " us per rollback ("
+			<< (seconds / std::max(1U, resimulated) * 1e9) << " ns per re-simulated tick)" << std::endl;
+	}
+}
+
+//---------------------------
+
+static void bench_search() {
+	//decision quality: the searcher (player 0) against chase_ball (player 1),
+	// from the same scattered kick-offs, at a fixed number of rollouts per decision:
+	const uint32_t Matches = 8;
+	const uint32_t DecideTicks = 10; //(decide at 24Hz, hold the controls in between)
+	const uint32_t MaxTicks = 240 * 20; //(a draw after 20 seconds)
+	Arena arena;
+	auto kick_off = [](uint32_t match) {
+		std::mt19937 mt(0x5ea4c4 + match);
+		std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+		GameState state;
+		state.ball.position = glm::vec3(0.6f * unit(mt), 1.2f * unit(mt), 0.2f);
+		state.ball.velocity = glm::vec3(1.5f * unit(mt), 1.5f * unit(mt), 0.0f);
+		return state;
+	};
+
+	std::cout << "search: player 0 by tree search vs chase_ball, " << Matches << " matches each" << std::endl;
+	for (uint32_t iterations : {0, 16, 64, 256}) {
+		SearchConfig config;
+		config.iterations = iterations;
+		SearchPlayer search(arena, 0, nullptr, config);
+		uint32_t wins = 0, losses = 0, rollouts = 0, decisions = 0;
+		double seconds = 0.0;
+		for (uint32_t match = 0; match < Matches; ++match) {
+			GameState state = kick_off(match);
+			GameInputs inputs;
+			for (uint32_t tick = 0; tick < MaxTicks && state.winner == -1; ++tick) {
+				if (tick % DecideTicks == 0) {
+					if (iterations == 0) {
+						inputs.players[0] = chase_ball(state, 0); //(baseline: the bot against itself)
+					} else {
+						inputs.players[0] = search.decide(state);
+						rollouts += search.last_rollouts;
+						seconds += search.last_seconds;
+						decisions += 1;
+					}
+				}
+				inputs.players[1] = chase_ball(state, 1);
+				step(arena, state, inputs, TickElapsed);
+			}
+			if (state.winner == 0) wins += 1;
+			if (state.winner == 1) losses += 1;
+		}
+		std::cout << "  " << (iterations ? std::to_string(iterations) + " rollouts/decision" : std::string("chase_ball")) << ": "
+			<< wins << " won, " << losses << " lost, " << (Matches - wins - losses) << " drawn";
+		if (decisions) {
+			std::cout << "; " << (seconds / decisions * 1e3) << " ms/decision, "
+				<< (rollouts / (seconds * 1e3)) << " rollouts/ms";
+		}
+		std::cout << std::endl;
+	}
+
+	//throughput within a frame budget, on one thread and on a pool:
+	JobPool pool;
+	for (JobPool *with : {(JobPool *)nullptr, &pool}) {
+		SearchPlayer search(arena, 0, with);
+		GameState state = kick_off(0);
+		uint32_t rollouts = 0;
+		double seconds = 0.0;
+		for (uint32_t rep = 0; rep < 50; ++rep) {
+			search.decide(state);
+			rollouts += search.last_rollouts;
+			seconds += search.last_seconds;
+		}
+		std::cout << "  " << (search.config.budget * 1e3) << " ms budget, " << (with ? with->size() : 1) << " thread(s): "
+			<< (rollouts / 50.0) << " rollouts/decision (" << (rollouts / (seconds * 1e3)) << " rollouts/ms)" << std::endl;
+	}
+}
+
+//---------------------------
+
+static void bench_predict() {
+	//BallPath against stepping the ball rules tick by tick (no spin stuff in the way):
+	const uint32_t Balls = 2000;
+	const float Horizon = 6.0f;
+	const uint32_t Ticks = uint32_t(std::ceil(Horizon / TickElapsed));
+	std::mt19937 mt(0xba11);
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	Arena arena;
+	std::vector< GameState::Ball > starts(Balls);
+	for (auto &ball : starts) {
+		ball.position = glm::vec3(3.0f * unit(mt), 1.5f * unit(mt), 0.2f);
+		ball.velocity = glm::vec3(4.0f * unit(mt), 4.0f * unit(mt), 0.0f);
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector< BallPath > paths;
+	paths.reserve(Balls);
+	for (auto const &ball : starts) paths.emplace_back(arena, ball, Horizon);
+	double build_seconds = since(start);
+
+	uint32_t segments = 0, scored = 0, goal_mismatches = 0, drifted = 0;
+	float worst = 0.0f;
+	double step_seconds = 0.0;
+	for (uint32_t i = 0; i < Balls; ++i) {
+		BallPath const &path = paths[i];
+		segments += uint32_t(path.segments.size());
+		GameState::Ball ball = starts[i];
+		int32_t winner = -1;
+		uint32_t goal_tick = -1U;
+		float error = 0.0f;
+		auto step_start = std::chrono::high_resolution_clock::now();
+		for (uint32_t tick = 1; tick <= Ticks && winner == -1; ++tick) {
+			step_balls(arena, nullptr, 0, ball_arrays(ball), TickElapsed, &winner);
+			if (winner != -1) goal_tick = tick;
+			error = std::max(error, glm::length(ball.position - path.position_at_tick(tick)));
+		}
+		step_seconds += since(step_start);
+		worst = std::max(worst, error);
+		drifted += (error > 1e-3f ? 1 : 0);
+		float seconds = 0.0f;
+		int32_t scorer = -1;
+		bool goal = path.time_to_goal(&seconds, &scorer);
+		scored += (goal ? 1 : 0);
+		if (goal != (winner != -1) || (goal && (scorer != winner || uint32_t(std::round(seconds / TickElapsed)) != goal_tick))) {
+			goal_mismatches += 1;
+		}
+	}
+
+	const uint32_t Queries = 1000000;
+	std::uniform_real_distribution< float > when(0.0f, Horizon);
+	float checksum = 0.0f;
+	start = std::chrono::high_resolution_clock::now();
+	for (uint32_t q = 0; q < Queries; ++q) {
+		checksum += paths[q % Balls].position(when(mt)).x;
+	}
+	double position_seconds = since(start);
+	start = std::chrono::high_resolution_clock::now();
+	for (uint32_t q = 0; q < Queries; ++q) {
+		float seconds = 0.0f;
+		if (paths[q % Balls].time_to_x(1.2f * unit(mt), &seconds)) checksum += seconds;
+	}
+	double reach_seconds = since(start);
+
+	std::cout << "predict: " << Balls << " balls over " << Horizon << " s; " << (float(segments) / Balls) << " segments per path, "
+		<< scored << " goals (" << goal_mismatches << " disagree with stepping)" << std::endl;
+	//(float rounding differs from stepping, so a ball that just grazes a wall or pillar can go either way)
+	std::cout << "  " << (Balls - drifted) << " paths stay within 1mm of stepping; worst " << worst << std::endl;
+	std::cout << "  build " << (build_seconds / Balls * 1e6) << " us per path vs stepping " << (step_seconds / Balls * 1e6)
+		<< " us; position(t) " << (position_seconds / Queries * 1e9) << " ns, time_to_x " << (reach_seconds / Queries * 1e9)
+		<< " ns (checksum " << checksum << ")" << std::endl;
+}
+
+//---------------------------
+
+static void bench_stream() {
+	//a match between chase_ball bots (re-started after each goal), published at 60Hz:
+	const uint32_t Ticks = 240 * 30;
+	const uint32_t Publish = 4;
+	const uint32_t AckDelay = 6; //(frames before an ack comes back: 100ms)
+	std::cout << "stream: " << (Ticks / 240) << "s of play, a frame every " << Publish << " ticks; acks " << AckDelay
+		<< " frames late, 5% of frames lost" << std::endl;
+	for (uint32_t extra : {0, 16, 256}) {
+		std::mt19937 mt(0x57e4);
+		std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+		Arena arena;
+		BallGrid grid(-arena.half_size, arena.half_size);
+		GameState state;
+		Balls balls;
+		for (uint32_t i = 0; i < extra; ++i) {
+			balls.add(glm::vec3(2.8f * unit(mt), 1.4f * unit(mt), 0.2f), glm::vec3(2.0f * unit(mt), 2.0f * unit(mt), 0.0f));
+		}
+		std::vector< StreamFrame > frames;
+		for (uint32_t tick = 0; tick < Ticks; ++tick) {
+			if (state.winner != -1) state = GameState();
+			GameInputs inputs;
+			inputs.players[0] = chase_ball(state, 0);
+			inputs.players[1] = chase_ball(state, 1);
+			step(arena, state, balls, grid, inputs, TickElapsed);
+			if (tick % Publish == 0) frames.emplace_back(quantize(tick, state, balls));
+		}
+
+		//as floats (like ServerPacket), quantised in full, and delta-coded:
+		size_t raw_bytes = frames.size() * (4 + 4 + 2 * 3 * 4 + (1 + extra) * 3 * 4);
+		size_t full_bytes = 0, live_bytes = 0, replay_bytes = 0;
+		uint32_t wrong = 0, unusable = 0;
+		double encode_seconds = 0.0, decode_seconds = 0.0;
+		{ //full frames (nothing acknowledged):
+			StreamEncoder encoder;
+			std::vector< uint8_t > packet;
+			for (auto const &frame : frames) {
+				packet.clear();
+				encoder.encode(frame, &packet);
+				full_bytes += packet.size();
+			}
+		}
+		{ //live: late acks, lost frames
+			StreamEncoder encoder;
+			StreamDecoder decoder;
+			std::vector< uint8_t > packet;
+			std::vector< uint32_t > acks; //(acks[i] arrives at the sender at frame i + AckDelay)
+			StreamFrame got;
+			for (uint32_t i = 0; i < frames.size(); ++i) {
+				if (i >= AckDelay && acks[i - AckDelay] != -1U) encoder.acknowledge(acks[i - AckDelay]);
+				packet.clear();
+				auto start = std::chrono::high_resolution_clock::now();
+				encoder.encode(frames[i], &packet);
+				encode_seconds += since(start);
+				live_bytes += packet.size();
+				acks.emplace_back(-1U);
+				if (mt() % 20 == 0) continue; //(lost)
+				start = std::chrono::high_resolution_clock::now();
+				bool ok = decoder.decode(packet.data(), packet.size(), &got);
+				decode_seconds += since(start);
+				if (!ok) {
+					unusable += 1;
+					continue;
+				}
+				if (!(got == frames[i])) wrong += 1;
+				acks.back() = got.tick;
+			}
+		}
+		{ //replay file: every frame against the one before
+			StreamEncoder encoder;
+			std::vector< uint8_t > packet;
+			for (auto const &frame : frames) {
+				packet.clear();
+				encoder.encode(frame, &packet);
+				encoder.acknowledge(frame.tick);
+				replay_bytes += packet.size() + 2; //(plus a length, to find the next one)
+			}
+		}
+
+		double per = 1.0 / frames.size();
+		std::cout << "  " << (1 + extra) << " balls: bytes per frame raw " << (raw_bytes * per) << ", quantised " << (full_bytes * per)
+			<< ", delta " << (live_bytes * per) << " (" << unusable << " baselines missing, " << wrong << " wrong), replay "
+			<< (replay_bytes * per) << "; encode " << (encode_seconds * per * 1e6) << " us ("
+			<< (live_bytes / encode_seconds * 1e-6) << " MB/s), decode " << (decode_seconds * per * 1e6) << " us" << std::endl;
+	}
+
+	//smallest-three rotations:
+	const uint32_t Rotations = 1000000;
+	std::mt19937 mt(0x9a7);
+	std::normal_distribution< float > normal;
+	std::vector< glm::quat > rotations(Rotations);
+	for (auto &rotation : rotations) {
+		rotation = glm::normalize(glm::quat(normal(mt), normal(mt), normal(mt), normal(mt)));
+	}
+	std::vector< uint32_t > packed(Rotations);
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < Rotations; ++i) packed[i] = pack_rotation(rotations[i]);
+	double pack_seconds = since(start);
+	float worst = 0.0f;
+	start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < Rotations; ++i) {
+		glm::quat back = unpack_rotation(packed[i]);
+		worst = std::max(worst, 2.0f * std::acos(std::min(1.0f, std::abs(glm::dot(back, rotations[i])))));
+	}
+	double unpack_seconds = since(start);
+	std::cout << "  rotations: 4 bytes each, worst error " << glm::degrees(worst) << " degrees; pack "
+		<< (pack_seconds / Rotations * 1e9) << " ns, unpack (and check) " << (unpack_seconds / Rotations * 1e9) << " ns" << std::endl;
+}
+
+//---------------------------
+
+static void bench_determinism() {
+	//sim_sincos against the library (as a reference, in double):
+	const uint32_t Angles = 1000000;
+	std::vector< float > angles(Angles);
+	for (uint32_t i = 0; i < Angles; ++i) angles[i] = (i / float(Angles) * 2.0f - 1.0f) * 2.0f * glm::two_pi< float >();
+	double worst = 0.0;
+	float sum = 0.0f;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (float angle : angles) {
+		float s, c;
+		sim_sincos(angle, &s, &c);
+		sum += s + c;
+	}
+	double sim_seconds = since(start);
+	start = std::chrono::high_resolution_clock::now();
+	for (float angle : angles) {
+		sum += std::sin(angle) + std::cos(angle);
+	}
+	double library_seconds = since(start);
+	for (float angle : angles) {
+		float s, c;
+		sim_sincos(angle, &s, &c);
+		worst = std::max(worst, std::max(std::abs(s - std::sin(double(angle))), std::abs(c - std::cos(double(angle)))));
+	}
+	std::cout << "determinism: sim_sincos " << (sim_seconds / Angles * 1e9) << " ns (library sin + cos "
+		<< (library_seconds / Angles * 1e9) << " ns), worst error " << worst << " (sum " << sum << ")" << std::endl;
+
+	//the per-tick hash, against the tick it checks; and hashes of fixed random matches, which
+	// should print the same for every compiler, platform, and optimisation level:
+	for (uint32_t extra : {0, 16}) {
+		const uint32_t Ticks = 240 * 120;
+		std::mt19937 mt(0xde7e);
+		Arena arena;
+		BallGrid grid(-arena.half_size, arena.half_size);
+		GameState state;
+		Balls balls;
+		for (uint32_t i = 0; i < extra; ++i) {
+			//(raw generator bits here and for the inputs: the standard distributions differ between libraries)
+			balls.add(glm::vec3((mt() % 5600) / 1000.0f - 2.8f, (mt() % 2800) / 1000.0f - 1.4f, 0.2f));
+		}
+		GameInputs inputs;
+		uint32_t hash = 0;
+		std::vector< GameState > states(Ticks);
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t tick = 0; tick < Ticks; ++tick) {
+			if (state.winner != -1) state = GameState();
+			if (tick % 80 == 0) inputs = unpack_inputs(uint16_t(mt() & 1023));
+			step(arena, state, balls, grid, inputs, TickElapsed);
+			hash = roll_hash(hash, state_hash(state));
+			if (extra) hash = roll_hash(hash, balls_hash(balls));
+			states[tick] = state;
+		}
+		double seconds = since(start);
+		//(the hashing alone, again:)
+		uint32_t again = 0;
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t tick = 0; tick < Ticks; ++tick) {
+			again = roll_hash(again, state_hash(states[tick]));
+			if (extra) again = roll_hash(again, balls_hash(balls));
+		}
+		double hash_seconds = since(start);
+		std::cout << "  " << (1 + extra) << " balls, " << (Ticks / 240) << "s of random play: hash " << std::hex << hash << std::dec
+			<< "; " << (seconds / Ticks * 1e9) << " ns per tick, of which hashing " << (hash_seconds / Ticks * 1e9) << " ns"
+			<< " (checksum " << again << ")" << std::endl;
+	}
+}
+
+//---------------------------
+
+static void bench_transforms() {
+	//world matrices for every node of a deep hierarchy (Chains chains of Depth transforms each),
+	// rebuilt from scratch (make_local_to_world) vs cached (local_to_world) as things move:
+	const uint32_t Chains = 64;
+	const uint32_t Depth = 256;
+	const uint32_t Count = Chains * Depth;
+	const uint32_t Frames = 20;
+	std::mt19937 mt(0x7f0b);
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	auto random_rotation = [&]() {
+		return glm::angleAxis(unit(mt), glm::normalize(glm::vec3(unit(mt), unit(mt), 1.0f)));
+	};
+
+	std::vector< Scene::Transform > nodes(Count);
+	for (uint32_t i = 0; i < Count; ++i) {
+		nodes[i].set_position(glm::vec3(unit(mt), unit(mt), unit(mt)) * 0.1f);
+		nodes[i].set_rotation(random_rotation());
+		nodes[i].set_scale(glm::vec3(1.0f + 0.01f * unit(mt)));
+		if (i % Depth != 0) nodes[i].set_parent(&nodes[i - 1]);
+	}
+
+	float checksum = 0.0f;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t f = 0; f < 2; ++f) {
+		for (auto const &node : nodes) checksum += node.make_local_to_world()[3][0];
+	}
+	double scratch_seconds = since(start) / 2;
+
+	//frames where 'moves' random nodes change (0: nothing, -1U: every chain's root):
+	auto frames = [&](uint32_t moves) {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t f = 0; f < Frames; ++f) {
+			if (moves == -1U) {
+				for (uint32_t c = 0; c < Chains; ++c) nodes[c * Depth].set_position(glm::vec3(unit(mt), unit(mt), 0.0f));
+			} else {
+				for (uint32_t m = 0; m < moves; ++m) nodes[mt() % Count].set_rotation(random_rotation());
+			}
+			for (auto const &node : nodes) checksum += node.local_to_world()[3][0];
+		}
+		return since(start) / Frames;
+	};
+	frames(0); //(fill the caches)
+	double still_seconds = frames(0);
+	double few_seconds = frames(Count / 100);
+	double roots_seconds = frames(-1U);
+
+	float worst = 0.0f;
+	for (auto const &node : nodes) {
+		glm::mat4 cached = node.local_to_world();
+		glm::mat4 scratch = node.make_local_to_world();
+		for (uint32_t c = 0; c < 4; ++c) {
+			for (uint32_t r = 0; r < 4; ++r) worst = std::max(worst, std::abs(cached[c][r] - scratch[c][r]));
+		}
+	}
+
+	std::cout << "transforms: " << Count << " nodes in " << Chains << " chains " << Depth << " deep; per frame:" << std::endl;
+	std::cout << "  from scratch " << (scratch_seconds * 1e3) << " ms; cached, nothing moved " << (still_seconds * 1e3)
+		<< " ms, 1% of nodes moved " << (few_seconds * 1e3) << " ms, every root moved " << (roots_seconds * 1e3) << " ms" << std::endl;
+	std::cout << "  cached matrices within " << worst << " of from-scratch ones (checksum " << checksum << ")" << std::endl;
+}
+
+//---------------------------
+
+static void bench_nodes() {
+	//a million-node forest (shallow, as scenes usually are) in SceneNodes against linked Scene::Transforms:
+	const uint32_t Count = 1000000;
+	const uint32_t Frames = 10;
+	std::mt19937 mt(0x90de5);
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	auto random_rotation = [&]() {
+		return glm::angleAxis(unit(mt), glm::normalize(glm::vec3(unit(mt), unit(mt), 1.0f)));
+	};
+
+	SceneNodes nodes;
+	std::vector< SceneNodes::Handle > handles;
+	std::vector< Scene::Transform > transforms(Count);
+	for (uint32_t i = 0; i < Count; ++i) {
+		glm::vec3 position = glm::vec3(unit(mt), unit(mt), unit(mt));
+		glm::quat rotation = random_rotation();
+		glm::vec3 scale = glm::vec3(1.0f + 0.1f * unit(mt));
+		//(one in sixteen is a root, the rest hang off some earlier node)
+		uint32_t parent = (i == 0 || mt() % 16 == 0 ? -1U : mt() % i);
+		handles.emplace_back(nodes.add(position, rotation, scale, parent == -1U ? SceneNodes::None : handles[parent]));
+		transforms[i].set_position(position);
+		transforms[i].set_rotation(rotation);
+		transforms[i].set_scale(scale);
+		if (parent != -1U) transforms[i].set_parent(&transforms[parent]);
+	}
+
+	float checksum = 0.0f;
+	auto start = std::chrono::high_resolution_clock::now();
+	nodes.update();
+	double first_seconds = since(start);
+	start = std::chrono::high_resolution_clock::now();
+	for (auto const &transform : transforms) checksum += transform.local_to_world()[3][0];
+	double linked_first_seconds = since(start);
+
+	//per frame, with 'moves' random nodes changed:
+	auto frames = [&](uint32_t moves, double *flat, double *linked) {
+		*flat = *linked = 0.0;
+		for (uint32_t f = 0; f < Frames; ++f) {
+			for (uint32_t m = 0; m < moves; ++m) {
+				uint32_t i = mt() % Count;
+				glm::quat rotation = random_rotation();
+				nodes.set_rotation(handles[i], rotation);
+				transforms[i].set_rotation(rotation);
+			}
+			auto start = std::chrono::high_resolution_clock::now();
+			nodes.update();
+			*flat += since(start) / Frames;
+			start = std::chrono::high_resolution_clock::now();
+			for (auto const &transform : transforms) checksum += transform.local_to_world()[3][0];
+			*linked += since(start) / Frames;
+		}
+	};
+	double still_flat, still_linked, few_flat, few_linked;
+	frames(0, &still_flat, &still_linked);
+	frames(Count / 100, &few_flat, &few_linked);
+
+	//re-parenting: 1% of nodes move under new roots (added after them, so the arrays need re-sorting):
+	const uint32_t Moves = Count / 100;
+	std::list< Scene::Transform > new_roots;
+	for (uint32_t m = 0; m < Moves; ++m) {
+		uint32_t i = mt() % Count;
+		glm::vec3 position = glm::vec3(unit(mt), unit(mt), 0.0f);
+		SceneNodes::Handle root = nodes.add(position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+		nodes.set_parent(handles[i], root);
+		new_roots.emplace_back();
+		new_roots.back().set_position(position);
+		transforms[i].set_parent(&new_roots.back());
+	}
+	start = std::chrono::high_resolution_clock::now();
+	nodes.update();
+	double resort_seconds = since(start);
+
+	float worst = 0.0f;
+	for (uint32_t i = 0; i < Count; ++i) {
+		glm::mat4 const &flat = nodes.local_to_world(handles[i]);
+		glm::mat4 const &linked = transforms[i].local_to_world();
+		for (uint32_t c = 0; c < 4; ++c) {
+			for (uint32_t r = 0; r < 4; ++r) worst = std::max(worst, std::abs(flat[c][r] - linked[c][r]));
+		}
+	}
+
+	std::cout << "nodes: " << Count << " transforms; all world matrices, SceneNodes vs linked Scene::Transforms:" << std::endl;
+	std::cout << "  first (with sorting) " << (first_seconds * 1e3) << " ms vs " << (linked_first_seconds * 1e3)
+		<< " ms; nothing moved " << (still_flat * 1e3) << " ms vs " << (still_linked * 1e3)
+		<< " ms; 1% moved " << (few_flat * 1e3) << " ms vs " << (few_linked * 1e3) << " ms" << std::endl;
+	std::cout << "  re-parenting 1% (re-sort and update) " << (resort_seconds * 1e3) << " ms; worst difference "
+		<< worst << " (checksum " << checksum << ")" << std::endl;
+}
+
+//---------------------------
+
+static void bench_objects() {
+	//Scene objects in a std::list (as they were) vs a SlotMap: adding, a render-like pass
+	// over every object's world matrix, and removing half of them in random order:
+	const uint32_t Count = 200000;
+	const uint32_t Passes = 20;
+	std::mt19937 mt(0x0b1ec7);
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	std::vector< glm::vec3 > positions(Count);
+	for (auto &position : positions) position = glm::vec3(unit(mt), unit(mt), unit(mt));
+	std::vector< uint32_t > doomed(Count);
+	for (uint32_t i = 0; i < Count; ++i) doomed[i] = i;
+	std::shuffle(doomed.begin(), doomed.end(), mt);
+	doomed.resize(Count / 2);
+
+	float checksum = 0.0f;
+	double list_seconds[3], map_seconds[3];
+	{
+		std::list< Scene::Object > objects;
+		std::vector< std::list< Scene::Object >::iterator > where;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < Count; ++i) {
+			objects.emplace_back();
+			objects.back().transform.set_position(positions[i]);
+			where.emplace_back(std::prev(objects.end()));
+		}
+		list_seconds[0] = since(start);
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t p = 0; p < Passes; ++p) {
+			for (auto const &object : objects) checksum += object.transform.local_to_world()[3][0];
+		}
+		list_seconds[1] = since(start) / Passes;
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i : doomed) objects.erase(where[i]);
+		list_seconds[2] = since(start);
+	}
+	{
+		SlotMap< Scene::Object > objects;
+		std::vector< Scene::ObjectHandle > handles;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < Count; ++i) {
+			handles.emplace_back(objects.add());
+			objects[handles.back()].transform.set_position(positions[i]);
+		}
+		map_seconds[0] = since(start);
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t p = 0; p < Passes; ++p) {
+			for (auto const &object : objects) checksum += object.transform.local_to_world()[3][0];
+		}
+		map_seconds[1] = since(start) / Passes;
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i : doomed) objects.remove(handles[i]);
+		map_seconds[2] = since(start);
+		//(the survivors should still be where their handles say)
+		uint32_t lost = 0;
+		std::vector< bool > gone(Count, false);
+		for (uint32_t i : doomed) gone[i] = true;
+		for (uint32_t i = 0; i < Count; ++i) {
+			if (gone[i] == objects.contains(handles[i])) lost += 1;
+			else if (!gone[i] && objects[handles[i]].transform.get_position() != positions[i]) lost += 1;
+		}
+		std::cout << "objects: " << Count << " scene objects, std::list vs SlotMap (" << lost << " handles lost track):" << std::endl;
+	}
+	std::cout << "  add " << (list_seconds[0] / Count * 1e9) << " ns vs " << (map_seconds[0] / Count * 1e9)
+		<< " ns each; pass over world matrices " << (list_seconds[1] * 1e3) << " ms vs " << (map_seconds[1] * 1e3)
+		<< " ms; remove " << (list_seconds[2] / doomed.size() * 1e9) << " ns vs " << (map_seconds[2] / doomed.size() * 1e9)
+		<< " ns each (checksum " << checksum << ")" << std::endl;
+}
+
+//---------------------------
+
+static void bench_prepare() {
+	//per-frame draw matrices (Scene::prepare) for a big scene, and SceneNodes::update for a bigger
+	// one, split over 1..N threads (every frame, a tenth of the objects and the camera move):
+	const uint32_t Objects = 200000;
+	const uint32_t Nodes = 1000000;
+	const uint32_t Frames = 10;
+	std::mt19937 mt(0xd4a3);
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+
+	Scene scene;
+	std::vector< Scene::ObjectHandle > handles;
+	for (uint32_t i = 0; i < Objects; ++i) {
+		handles.emplace_back(scene.objects.add());
+		Scene::Object &object = scene.objects[handles.back()];
+		object.transform.set_position(glm::vec3(unit(mt), unit(mt), unit(mt)) * 10.0f);
+		object.transform.set_rotation(glm::angleAxis(unit(mt), glm::vec3(0.0f, 0.0f, 1.0f)));
+		object.count = i;
+		//(a quarter are parts of some recently added object, as a model's parts would be)
+		if (i > 0 && mt() % 4 == 0) object.transform.set_parent(&scene.objects[handles[i - 1 - mt() % std::min(i, 64U)]].transform);
+	}
+	SceneNodes nodes;
+	std::vector< SceneNodes::Handle > node_handles;
+	for (uint32_t i = 0; i < Nodes; ++i) {
+		uint32_t parent = (i == 0 || mt() % 16 == 0 ? -1U : mt() % i);
+		node_handles.emplace_back(nodes.add(glm::vec3(unit(mt), unit(mt), unit(mt)), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f),
+			parent == -1U ? SceneNodes::None : node_handles[parent]));
+	}
+
+	//(the first update sorts the nodes depth-first, and the first prepare fills every cache)
+	nodes.update();
+	scene.prepare();
+
+	//the same moves for every thread count (each sets positions outright, so replaying
+	// frames 0..Frames-1 always ends in the same scene, whatever ran before):
+	auto frame = [&](uint32_t f) {
+		std::mt19937 moves(f);
+		for (uint32_t m = 0; m < Objects / 10; ++m) {
+			scene.objects[handles[moves() % Objects]].transform.set_position(glm::vec3(unit(moves), unit(moves), unit(moves)) * 10.0f);
+		}
+		for (uint32_t m = 0; m < Nodes / 10; ++m) {
+			nodes.set_position(node_handles[moves() % Nodes], glm::vec3(unit(moves), unit(moves), unit(moves)));
+		}
+		scene.camera.transform.set_position(glm::vec3(20.0f * std::cos(f * 0.1f), 20.0f * std::sin(f * 0.1f), 5.0f));
+	};
+
+	std::vector< Scene::Draw > serial_draws;
+	std::vector< glm::mat4 > serial_worlds;
+	uint32_t most = std::max(2U, std::thread::hardware_concurrency());
+	std::cout << "prepare: " << Objects << " scene objects, " << Nodes << " scene nodes; per frame (" << std::thread::hardware_concurrency() << " cores here):" << std::endl;
+	for (uint32_t threads = 1; threads <= most; threads = (threads * 2 > most && threads < most ? most : threads * 2)) {
+		JobPool pool(threads);
+		double draw_seconds = 0.0, node_seconds = 0.0;
+		for (uint32_t f = 0; f < Frames; ++f) {
+			frame(f);
+			auto start = std::chrono::high_resolution_clock::now();
+			scene.prepare(&pool);
+			draw_seconds += since(start) / Frames;
+			start = std::chrono::high_resolution_clock::now();
+			nodes.update(&pool);
+			node_seconds += since(start) / Frames;
+		}
+		//(every thread count should come out the same, since each frame's moves were)
+		bool same = true;
+		if (threads == 1) {
+			serial_draws = scene.draws;
+			for (auto const &handle : node_handles) serial_worlds.emplace_back(nodes.local_to_world(handle));
+		} else {
+			//(bit for bit; nodes looked up by handle, as a caller would)
+			same = (std::memcmp(scene.draws.data(), serial_draws.data(), Objects * sizeof(Scene::Draw)) == 0);
+			for (uint32_t i = 0; i < Nodes && same; ++i) {
+				same = (std::memcmp(&nodes.local_to_world(node_handles[i]), &serial_worlds[i], sizeof(glm::mat4)) == 0);
+			}
+		}
+		std::cout << "  " << threads << " thread" << (threads > 1 ? "s" : " ") << ": Scene::prepare " << (draw_seconds * 1e3)
+			<< " ms, SceneNodes::update " << (node_seconds * 1e3) << " ms" << (same ? "" : " (DIFFERENT from 1 thread!)") << std::endl;
+	}
+}
+
+//---------------------------
+
+static void bench_inverse() {
+	//world-to-local from the cached local-to-world (affine_inverse) vs the recursive
+	// make_world_to_local, for chains of transforms with uniform scales (so the closed form
+	// applies all the way down) and with non-uniform ones (sheared: the 3x3 inverse fallback):
+	const uint32_t Chains = 64;
+	const uint32_t Depth = 64;
+	const uint32_t Count = Chains * Depth;
+	std::mt19937 mt(0x1a7e);
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+
+	for (uint32_t sheared = 0; sheared < 2; ++sheared) {
+		std::vector< Scene::Transform > nodes(Count);
+		for (uint32_t i = 0; i < Count; ++i) {
+			nodes[i].set_position(glm::vec3(unit(mt), unit(mt), unit(mt)) * 0.5f);
+			nodes[i].set_rotation(glm::angleAxis(unit(mt), glm::normalize(glm::vec3(unit(mt), unit(mt), 1.0f))));
+			float s = 1.0f + 0.02f * unit(mt);
+			nodes[i].set_scale(sheared ? glm::vec3(s, 1.0f + 0.02f * unit(mt), 1.0f + 0.02f * unit(mt)) : glm::vec3(s));
+			if (i % Depth != 0) nodes[i].set_parent(&nodes[i - 1]);
+		}
+		for (auto const &node : nodes) node.local_to_world(); //(fill the caches, as a frame would)
+
+		float checksum = 0.0f;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (auto const &node : nodes) checksum += node.make_world_to_local()[3][0];
+		double recursive_seconds = since(start);
+		start = std::chrono::high_resolution_clock::now();
+		for (auto const &node : nodes) checksum += node.world_to_local()[3][0];
+		double closed_seconds = since(start);
+
+		//how far inverse * local_to_world is from the identity, for each:
+		float recursive_error = 0.0f, closed_error = 0.0f;
+		for (auto const &node : nodes) {
+			glm::mat4 const &world = node.local_to_world();
+			glm::mat4 a = node.make_world_to_local() * world;
+			glm::mat4 b = node.world_to_local() * world;
+			for (uint32_t c = 0; c < 4; ++c) {
+				for (uint32_t r = 0; r < 4; ++r) {
+					float identity = (c == r ? 1.0f : 0.0f);
+					recursive_error = std::max(recursive_error, std::abs(a[c][r] - identity));
+					closed_error = std::max(closed_error, std::abs(b[c][r] - identity));
+				}
+			}
+		}
+
+		std::cout << "inverse: " << Count << " transforms in chains " << Depth << " deep, " << (sheared ? "non-uniform" : "uniform") << " scales:" << std::endl;
+		std::cout << "  make_world_to_local " << (recursive_seconds / Count * 1e9) << " ns, world_to_local " << (closed_seconds / Count * 1e9)
+			<< " ns each; worst error (inverse * local_to_world - identity) " << recursive_error << " vs " << closed_error
+			<< " (checksum " << checksum << ")" << std::endl;
+	}
+}
+
+//---------------------------
+
+int main(int argc, char **argv) {
+	struct Bench {
+		std::string name;
+		void (*run)();
+	};
+	std::vector< Bench > benches = {
+		{ "step", bench_step },
+		{ "swept", bench_swept },
+		{ "balls", bench_balls },
+		{ "grid", bench_grid },
+		{ "simd", bench_simd },
+		{ "collider", bench_collider },
+		{ "ffa", bench_ffa },
+		{ "snapshot", bench_snapshot },
+		{ "rollback", bench_rollback },
+		{ "search", bench_search },
+		{ "predict", bench_predict },
+		{ "stream", bench_stream },
+		{ "determinism", bench_determinism },
+		{ "transforms", bench_transforms },
+		{ "nodes", bench_nodes },
+		{ "objects", bench_objects },
+		{ "prepare", bench_prepare },
+		{ "inverse", bench_inverse },
+	};
+
+	std::vector< std::string > names(argv + 1, argv + argc);
+	for (auto const &name : names) {
+		bool found = false;
+		for (auto const &bench : benches) {
+			if (bench.name == name) found = true;
+		}
+		if (!found) {
+			std::cerr << "Unknown benchmark '" << name << "'; have:";
+			for (auto const &bench : benches) std::cerr << " " << bench.name;
+			std::cerr << std::endl;
+			return 1;
+		}
+	}
+
+	for (auto const &bench : benches) {
+		bool run = names.empty();
+		for (auto const &name : names) {
+			if (bench.name == name) run = true;
+		}
+		if (run) bench.run();
+	}
+
+	return 0;
+}
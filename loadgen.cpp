@@ -0,0 +1,387 @@
+//Load generator for dist/server: plays thousands of fake players over loopback
+// (one UDP socket each, so the server sees them as separate clients) and reports
+// what the server's service looked like from the players' side, for sizing
+// hardware and catching performance regressions.
+//
+// Players send their held controls at 60Hz, like main.cpp does. The controls come
+// from a recording (--replay, made with main's --record; each match starts at a
+// different place in it), or else from a model of someone on a keyboard (holding
+// a direction or two for a fraction of a second, now and then tapping toggle).
+//
+// Reports:
+//  - round trip: from sending a packet to getting a state that acknowledges it
+//    (includes waiting for the server's next tick and its next 60Hz send);
+//  - state interval: time between states from the server (should be 1/60s), and
+//    states the server sent that never came;
+//  - packet rates; and with --server-pid, the server's CPU time per match.
+// --max-p99-ms and --min-delivered make the exit status fail when service is worse,
+// so a run can gate a build.
+//
+// usage: loadgen [--port P] [--shards N] [--matches N] [--seconds S] [--threads N] [--replay FILE]
+//                [--server-pid PID] [--max-p99-ms MS] [--min-delivered F]
+
+#ifndef __linux__
+#error "loadgen is built on epoll and timerfd, so is Linux-only"
+#endif
+
+#include "Replay.hpp"
+#include "ServerProtocol.hpp"
+#include "Histogram.hpp"
+
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_between(Clock::time_point const &a, Clock::time_point const &b) {
+	return std::chrono::duration< double >(b - a).count();
+}
+
+//where the held controls come from:
+struct InputSource {
+	std::vector< uint16_t > recorded; //per tick, from pack_inputs (empty: make them up)
+};
+
+struct Player {
+	int fd = -1;
+	uint32_t match = 0;
+	uint8_t player = 0;
+	uint32_t sequence = 0;
+	Clock::time_point sent_at[64]; //by sequence % 64
+	uint32_t acked = 0; //newest sequence the server has acknowledged
+	Clock::time_point last_state; //when the latest state arrived
+	uint32_t last_tick = -1U; //match tick of the latest state
+
+	//made-up keyboard:
+	uint8_t held = 0;
+	uint32_t change_at = 0; //frame to pick new keys
+};
+
+struct Stats {
+	uint64_t sent = 0, received = 0;
+	uint64_t missing = 0; //states the server sent (judging by tick numbers) that didn't arrive
+	Histogram round_trip = Histogram(100e-6, 1000);
+	Histogram interval = Histogram(100e-6, 1000);
+
+	void add(Stats const &other) {
+		sent += other.sent;
+		received += other.received;
+		missing += other.missing;
+		round_trip.add(other.round_trip);
+		interval.add(other.interval);
+	}
+};
+
+//One thread's share of the players:
+struct Worker {
+	std::vector< Player > players;
+	Stats stats;
+	std::thread thread;
+
+	void run(InputSource const &source, Clock::time_point measure_from, Clock::time_point stop_at);
+
+private:
+	std::mt19937 mt;
+	uint8_t next_input(Player &player, uint32_t frame, InputSource const &source);
+	void receive(Player &player, Clock::time_point measure_from);
+};
+
+uint8_t Worker::next_input(Player &player, uint32_t frame, InputSource const &source) {
+	if (!source.recorded.empty()) {
+		//(60Hz frames step through the 240Hz recording four ticks at a time)
+		uint32_t tick = (frame * 4 + player.match * 997) % uint32_t(source.recorded.size());
+		return uint8_t((source.recorded[tick] >> (5 * player.player)) & 31);
+	}
+	if (frame >= player.change_at) {
+		//hold a direction (sometimes two, sometimes none) for 0.2 to 1s:
+		uint32_t keys = mt() % 9;
+		uint8_t horizontal = (keys % 3 == 0 ? 0 : keys % 3 == 1 ? 1 : 2); //left / right
+		uint8_t vertical = (keys / 3 == 0 ? 0 : keys / 3 == 1 ? 4 : 8); //up / down
+		player.held = horizontal | vertical;
+		player.change_at = frame + 12 + mt() % 48;
+		if (mt() % 4 == 0) player.held |= 16; //tap toggle as the new keys go down
+	} else {
+		player.held &= ~16; //(toggle is only held for a frame)
+	}
+	return player.held;
+}
+
+void Worker::receive(Player &player, Clock::time_point measure_from) {
+	ServerPacket packet;
+	while (true) {
+		ssize_t got = recv(player.fd, &packet, sizeof(packet), MSG_DONTWAIT);
+		if (got < 0) return;
+		if (got != sizeof(packet) || std::memcmp(packet.magic, ServerPacket().magic, 4) != 0) continue;
+		auto now = Clock::now();
+		bool measuring = (now >= measure_from);
+		if (measuring) stats.received += 1;
+
+		if (int32_t(packet.ack - player.acked) > 0 && player.sequence - packet.ack < 64) {
+			player.acked = packet.ack;
+			if (measuring) stats.round_trip.add(seconds_between(player.sent_at[packet.ack % 64], now));
+		}
+		if (player.last_tick != -1U && packet.tick > player.last_tick) {
+			if (measuring) {
+				stats.interval.add(seconds_between(player.last_state, now));
+				//(the server sends every fourth tick)
+				uint32_t sends = (packet.tick - player.last_tick + 2) / 4;
+				if (sends > 1) stats.missing += sends - 1;
+			}
+		}
+		player.last_tick = packet.tick;
+		player.last_state = now;
+	}
+}
+
+void Worker::run(InputSource const &source, Clock::time_point measure_from, Clock::time_point stop_at) {
+	mt.seed(uint32_t(players.empty() ? 0 : players[0].match));
+
+	int epoll_fd = epoll_create1(0);
+	int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	if (epoll_fd < 0 || timer_fd < 0) throw std::runtime_error("Failed to create epoll instance or timer");
+	itimerspec spec;
+	spec.it_interval.tv_sec = 0;
+	spec.it_interval.tv_nsec = 16666667; //60Hz
+	spec.it_value = spec.it_interval;
+	timerfd_settime(timer_fd, 0, &spec, nullptr);
+
+	epoll_event event;
+	std::memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = -1U;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event);
+	for (uint32_t i = 0; i < players.size(); ++i) {
+		event.data.u32 = i;
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, players[i].fd, &event);
+	}
+
+	uint32_t frame = 0;
+	std::vector< epoll_event > events(256);
+	while (Clock::now() < stop_at) {
+		int count = epoll_wait(epoll_fd, events.data(), int(events.size()), 100);
+		for (int e = 0; e < count; ++e) {
+			if (events[e].data.u32 != -1U) {
+				receive(players[events[e].data.u32], measure_from);
+				continue;
+			}
+			uint64_t fired = 0;
+			if (read(timer_fd, &fired, sizeof(fired)) != sizeof(fired)) continue;
+			//(if frames were missed, just send the current one -- like a game that hitched)
+			frame += uint32_t(fired);
+			auto now = Clock::now();
+			for (auto &player : players) {
+				ClientPacket packet;
+				packet.match = player.match;
+				packet.player = player.player;
+				packet.sequence = ++player.sequence;
+				packet.input = next_input(player, frame, source);
+				player.sent_at[packet.sequence % 64] = now;
+				if (send(player.fd, &packet, sizeof(packet), MSG_DONTWAIT) == sizeof(packet) && now >= measure_from) {
+					stats.sent += 1;
+				}
+			}
+		}
+	}
+	close(timer_fd);
+	close(epoll_fd);
+}
+
+//user + system CPU seconds used so far by process 'pid' (or -1 if it can't be read):
+static double process_cpu_seconds(int pid) {
+	std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+	std::string line;
+	if (!std::getline(stat, line)) return -1.0;
+	//(fields after the command name, which is in parentheses and may contain spaces)
+	auto close_paren = line.rfind(')');
+	if (close_paren == std::string::npos) return -1.0;
+	std::vector< std::string > fields;
+	std::string field;
+	for (char c : line.substr(close_paren + 2)) {
+		if (c == ' ') {
+			fields.emplace_back(field);
+			field.clear();
+		} else {
+			field += c;
+		}
+	}
+	if (fields.size() < 13) return -1.0;
+	//utime and stime are fields 14 and 15 of the whole line (11 and 12 after the name and state):
+	double ticks = std::atof(fields[11].c_str()) + std::atof(fields[12].c_str());
+	return ticks / double(sysconf(_SC_CLK_TCK));
+}
+
+int main(int argc, char **argv) {
+	struct {
+		uint16_t port = 7777;
+		uint32_t shards = 0; //0 = one per core (as the server picks)
+		uint32_t matches = 1000;
+		float seconds = 10.0f;
+		uint32_t threads = 1;
+		std::string replay;
+		int server_pid = 0;
+		float max_p99_ms = 0.0f; //0 = don't check
+		float min_delivered = 0.0f;
+	} config;
+
+	bool ok = true;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		bool has_value = (argi + 1 < argc);
+		std::string value = (has_value ? argv[argi + 1] : "");
+		if (!has_value) {
+			ok = false;
+		} else if (arg == "--port") {
+			config.port = uint16_t(std::atoi(value.c_str()));
+		} else if (arg == "--shards") {
+			config.shards = uint32_t(std::atoi(value.c_str()));
+		} else if (arg == "--matches") {
+			config.matches = uint32_t(std::atoi(value.c_str()));
+		} else if (arg == "--seconds") {
+			config.seconds = float(std::atof(value.c_str()));
+		} else if (arg == "--threads") {
+			config.threads = uint32_t(std::max(1, std::atoi(value.c_str())));
+		} else if (arg == "--replay") {
+			config.replay = value;
+		} else if (arg == "--server-pid") {
+			config.server_pid = std::atoi(value.c_str());
+		} else if (arg == "--max-p99-ms") {
+			config.max_p99_ms = float(std::atof(value.c_str()));
+		} else if (arg == "--min-delivered") {
+			config.min_delivered = float(std::atof(value.c_str()));
+		} else {
+			ok = false;
+		}
+		if (!ok) break;
+		++argi;
+	}
+	if (!ok) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--port P] [--shards N] [--matches N] [--seconds S] [--threads N] [--replay FILE]\n"
+			"\t\t[--server-pid PID] [--max-p99-ms MS] [--min-delivered F]" << std::endl;
+		return 1;
+	}
+	if (config.shards == 0) config.shards = std::max(1U, std::thread::hardware_concurrency());
+
+	InputSource source;
+	if (!config.replay.empty()) {
+		ReplayReader replay(config.replay);
+		GameInputs inputs;
+		while (replay.next(&inputs)) {
+			source.recorded.emplace_back(pack_inputs(inputs));
+		}
+		if (source.recorded.empty()) throw std::runtime_error("Replay '" + config.replay + "' has no ticks");
+	}
+
+	//two sockets per match (so: lots of file descriptors):
+	rlimit files;
+	if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+		files.rlim_cur = files.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &files);
+	}
+
+	std::vector< std::unique_ptr< Worker > > workers;
+	for (uint32_t t = 0; t < config.threads; ++t) {
+		workers.emplace_back(new Worker);
+	}
+	for (uint32_t m = 0; m < config.matches; ++m) {
+		for (uint8_t p = 0; p < 2; ++p) {
+			Player player;
+			player.match = m;
+			player.player = p;
+			player.fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+			if (player.fd < 0) throw std::runtime_error("Failed to create socket " + std::to_string(2 * m + p) + " (out of file descriptors?)");
+			sockaddr_in server;
+			std::memset(&server, 0, sizeof(server));
+			server.sin_family = AF_INET;
+			server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			server.sin_port = htons(uint16_t(config.port + m % config.shards));
+			//(connecting means send() needs no address, and only the server's packets come back)
+			if (connect(player.fd, reinterpret_cast< sockaddr const * >(&server), sizeof(server)) != 0) {
+				throw std::runtime_error("Failed to connect socket to the server");
+			}
+			workers[m % config.threads]->players.emplace_back(player);
+		}
+	}
+
+	std::cout << "loadgen: " << config.matches << " matches (" << 2 * config.matches << " players) against 127.0.0.1:"
+		<< config.port << "-" << (config.port + config.shards - 1) << " for " << config.seconds << "s, "
+		<< (source.recorded.empty() ? std::string("made-up keyboard input") : "input from " + config.replay) << std::endl;
+
+	//(the first second, while players join, isn't measured)
+	auto start = Clock::now();
+	auto measure_from = start + std::chrono::seconds(1);
+	auto stop_at = start + std::chrono::duration_cast< Clock::duration >(std::chrono::duration< float >(config.seconds + 1.0f));
+	double server_cpu_before = -1.0;
+	for (auto &worker : workers) {
+		Worker *w = worker.get();
+		worker->thread = std::thread([w, &source, measure_from, stop_at]() { w->run(source, measure_from, stop_at); });
+	}
+	std::this_thread::sleep_until(measure_from);
+	if (config.server_pid) server_cpu_before = process_cpu_seconds(config.server_pid);
+	rusage usage_before;
+	getrusage(RUSAGE_SELF, &usage_before);
+
+	Stats total;
+	for (auto &worker : workers) {
+		worker->thread.join();
+		total.add(worker->stats);
+	}
+	double seconds = seconds_between(measure_from, Clock::now());
+	double server_cpu_after = (config.server_pid ? process_cpu_seconds(config.server_pid) : -1.0);
+	rusage usage_after;
+	getrusage(RUSAGE_SELF, &usage_after);
+	for (auto &worker : workers) {
+		for (auto &player : worker->players) close(player.fd);
+	}
+
+	auto cpu = [](rusage const &usage) {
+		return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + 1e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+	};
+
+	//(each player expects a state every fourth server tick)
+	double expected = 2.0 * config.matches * seconds / (4.0 * TickElapsed);
+	double delivered = total.received / expected;
+	double p99_ms = total.round_trip.percentile(0.99) * 1e3;
+	std::cout << "  packets: " << (total.sent / seconds) << "/s sent, " << (total.received / seconds) << "/s received ("
+		<< (delivered * 100.0) << "% of states expected; " << total.missing << " sent but lost)" << std::endl;
+	std::cout << "  round trip: p50 " << (total.round_trip.percentile(0.5) * 1e3) << "ms, p90 " << (total.round_trip.percentile(0.9) * 1e3)
+		<< "ms, p99 " << p99_ms << "ms, worst " << (total.round_trip.worst * 1e3) << "ms (" << total.round_trip.total << " samples)" << std::endl;
+	std::cout << "  state interval: p50 " << (total.interval.percentile(0.5) * 1e3) << "ms, p99 " << (total.interval.percentile(0.99) * 1e3)
+		<< "ms, worst " << (total.interval.worst * 1e3) << "ms (ideal " << (4.0 * TickElapsed * 1e3) << "ms)" << std::endl;
+	std::cout << "  cpu: loadgen " << (cpu(usage_after) - cpu(usage_before)) / seconds << " cores";
+	if (server_cpu_before >= 0.0 && server_cpu_after >= 0.0) {
+		double server_cores = (server_cpu_after - server_cpu_before) / seconds;
+		std::cout << ", server " << server_cores << " cores = " << (server_cores / config.matches * 1e6) << " us of cpu per match-second";
+		if (server_cores > 0.0) std::cout << " (" << (config.matches / server_cores) << " matches/core)";
+	}
+	std::cout << std::endl;
+
+	bool pass = true;
+	if (config.max_p99_ms > 0.0f && !(p99_ms <= config.max_p99_ms)) {
+		std::cout << "FAIL: round trip p99 " << p99_ms << "ms is over " << config.max_p99_ms << "ms" << std::endl;
+		pass = false;
+	}
+	if (config.min_delivered > 0.0f && !(delivered >= config.min_delivered)) {
+		std::cout << "FAIL: delivered " << delivered << " of expected states, under " << config.min_delivered << std::endl;
+		pass = false;
+	}
+	return pass ? 0 : 1;
+}
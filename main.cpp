@@ -3,74 +3,87 @@
 #include "Meshes.hpp"
 #include "Scene.hpp"
 #include "read_chunk.hpp"
+#include "Game.hpp"
+#include "Balls.hpp"
+#include "BallGrid.hpp"
+#include "Replay.hpp"
+#include "Net.hpp"
+#include "Search.hpp"
+#include "JobPool.hpp"
 
 #include <SDL.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/closest_point.hpp>
 
 #include <chrono>
 #include <iostream>
 #include <stdexcept>
 #include <fstream>
+#include <algorithm>
+#include <random>
+#include <cstdlib>
+#include <memory>
 
 static GLuint compile_shader(GLenum type, std::string const &source);
 static GLuint link_program(GLuint vertex_shader, GLuint fragment_shader);
 
-// detect the collision between a spinning stuff and a pillar
-bool spin_collide_pillars(Scene::Object * spin) {
-	if(distance(spin->transform.position, glm::vec3(2.0f, 0.0f, 0.16f))<0.38f || distance(spin->transform.position, glm::vec3(-2.0f, 0.0f, 0.16f))<0.38f) {
-		return true;
-	}
-	else {
-		return false;
-	}
-}
-
-// detect the collision between two spinning stuff
-bool spins_collide(Scene::Object * spin1, Scene::Object * spin2) {
-	if(distance(spin1->transform.position, spin2->transform.position)<0.55) {
-		return true;
-	}
-	else {
-		return false;
-	}
-}
-
-// detect the collision between the spin stuff and the ball
-bool spin_collide_ball(Scene::Object * spin, Scene::Object * ball) {
-	glm::vec3 n = glm::normalize(glm::mat4_cast(spin->transform.rotation) * glm::vec4(-1.0f, 0.0f, 0.0f, 1.0f));
-	glm::vec3 v = glm::vec3(-1.0f * n.y, n.x, 0.0f);
-	glm::vec3 p1 = spin->transform.position + (0.005f * n);
-	glm::vec3 p2 = p1 + (0.32f * v);
-	glm::vec3 p3 = p2 - (0.01f * n);
-	glm::vec3 p4 = spin->transform.position - (0.005f * n);
-	glm::vec3 p12 = closestPointOnLine(ball->transform.position, p1, p2);
-	glm::vec3 p34 = closestPointOnLine(ball->transform.position, p3, p4);
-	glm::vec3 p14 = closestPointOnLine(ball->transform.position, p1, p4);
-	glm::vec3 p23 = closestPointOnLine(ball->transform.position, p2, p3);
-	float d12 = distance(ball->transform.position, p12);
-	float d34 = distance(ball->transform.position, p34);
-	float d14 = distance(ball->transform.position, p14);
-	float d23 = distance(ball->transform.position, p23);
-	
-	if(d12 + d34 <= 0.2 && d14 + d23 <= 3.0) {
-		return true;
-	}
-	else {
-		return false;
-	}
-}
-
 int main(int argc, char **argv) {
 	//Configuration:
 	struct {
 		std::string title = "Game3: Spin";
 		glm::uvec2 size = glm::uvec2(1024, 512);
+		uint32_t balls = 1; //multi-ball mode when > 1
+		std::string record; //write inputs to this file (if not empty)
+		std::string replay; //play inputs from this file instead of the keyboard (if not empty)
+		bool replay_max_speed = false; //play back as many ticks as fit in a frame, not in real time
+		//networked match (when net_player is 0 or 1): we play net_player, the peer plays the other:
+		int32_t net_player = -1;
+		uint16_t net_port = 0;
+		std::string net_peer; //host:port
+		uint32_t net_delay = 2; //ticks of input delay (both ends must agree)
+		int32_t ai = -1; //player (0 or 1) steered by tree search instead of the keyboard
 	} config;
 
+	bool bad_arguments = false;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--balls" && argi + 1 < argc) {
+			config.balls = std::max(1, std::atoi(argv[++argi]));
+		} else if (arg == "--record" && argi + 1 < argc) {
+			config.record = argv[++argi];
+		} else if (arg == "--replay" && argi + 1 < argc) {
+			config.replay = argv[++argi];
+		} else if (arg == "--replay-speed" && argi + 1 < argc && (std::string(argv[argi + 1]) == "realtime" || std::string(argv[argi + 1]) == "max")) {
+			config.replay_max_speed = (std::string(argv[++argi]) == "max");
+		} else if (arg == "--net-player" && argi + 1 < argc) {
+			config.net_player = std::atoi(argv[++argi]);
+		} else if (arg == "--net-port" && argi + 1 < argc) {
+			config.net_port = uint16_t(std::atoi(argv[++argi]));
+		} else if (arg == "--net-peer" && argi + 1 < argc) {
+			config.net_peer = argv[++argi];
+		} else if (arg == "--net-delay" && argi + 1 < argc) {
+			config.net_delay = uint32_t(std::atoi(argv[++argi]));
+		} else if (arg == "--ai" && argi + 1 < argc) {
+			config.ai = std::atoi(argv[++argi]);
+		} else {
+			bad_arguments = true;
+			break;
+		}
+	}
+	bool networked = (config.net_player == 0 || config.net_player == 1);
+	if (bad_arguments || config.net_player < -1 || config.net_player > 1
+		|| config.ai < -1 || config.ai > 1 || (config.ai != -1 && (config.balls > 1 || !config.replay.empty()))
+		|| (networked && (config.net_port == 0 || config.net_peer.empty()
+		|| config.net_delay >= Rollback::MaxPrediction || config.balls > 1 || !config.replay.empty() || !config.record.empty()))) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--balls N] [--record FILE] [--replay FILE [--replay-speed realtime|max]]\n"
+			"\t\t[--net-player 0|1 --net-port P --net-peer HOST:PORT [--net-delay TICKS]] [--ai 0|1]\n"
+			"\t(networked matches are single-ball, and can't be recorded or replayed)\n"
+			"\t(the --ai player searches single-ball matches only, and can't take over a replay)\n"
+			"\t(while replaying, '[' and ']' jump ten seconds back and ahead, and Home goes to the start)" << std::endl;
+		return 1;
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -211,24 +224,27 @@ int main(int argc, char **argv) {
 	//(transform will be handled in the update function below)
 	
 	//add some objects from the mesh library:
-	auto add_object = [&](std::string const &name, glm::vec3 const &position, glm::quat const &rotation, glm::vec3 const &scale) -> Scene::Object & {
+	auto add_object = [&](std::string const &name, glm::vec3 const &position, glm::quat const &rotation, glm::vec3 const &scale) -> Scene::ObjectHandle {
 		Mesh const &mesh = meshes.get(name);
-		scene.objects.emplace_back();
-		Scene::Object &object = scene.objects.back();
-		object.transform.position = position;
-		object.transform.rotation = rotation;
-		object.transform.scale = scale;
+		Scene::ObjectHandle handle = scene.objects.add();
+		Scene::Object &object = scene.objects[handle];
+		object.transform.set_position(position);
+		object.transform.set_rotation(rotation);
+		object.transform.set_scale(scale);
 		object.vao = mesh.vao;
 		object.start = mesh.start;
 		object.count = mesh.count;
 		object.program = program;
 		object.program_mvp = program_mvp;
 		object.program_itmv = program_itmv;
-		return object;
+		return handle;
 	};
 
 
-	{ //read objects to add from "scene.blob":
+	//arena colliders (pillars, walls, goal lines):
+	Arena arena;
+
+	{ //read objects (and colliders) to add from "scene.blob":
 		std::ifstream file("scene_spin.blob", std::ios::binary);
 
 		std::vector< char > strings;
@@ -255,27 +271,82 @@ int main(int argc, char **argv) {
 				add_object(name, entry.position, entry.rotation, entry.scale);
 			}
 		}
+
+		//read collider chunk:
+		arena.load(file);
+	}
+
+	//a replay brings its own colliders, tuning, and balls (so it plays out as it was recorded):
+	std::unique_ptr< ReplayReader > replay;
+	if (!config.replay.empty()) {
+		replay.reset(new ReplayReader(config.replay));
+		arena = replay->arena;
 	}
 	
+	//game rules live in GameState (see Game.hpp); the scene objects below just mirror it:
+	GameState state;
+
 	// spins
-	std::vector< Scene::Object * > spin_stack;
-	spin_stack.emplace_back( &add_object("Spin", glm::vec3(-1.2f, 0.0f, 0.16f), glm::quat(0.0f, 0.0f, 0.0f, 1.0f), glm::vec3(0.05f)) );
-	spin_stack.emplace_back( &add_object("Spin", glm::vec3(1.2f, 0.0f, 0.16f), glm::quat(0.0f, 0.0f, 0.0f, -1.0f), glm::vec3(0.05f)) );
-
-	std::vector< float > spin_angle(spin_stack.size(), 0.0f);
-	std::vector< float > spin_cloclwise(spin_stack.size(), -1.0f);
-	std::vector< bool > spin_changing(spin_stack.size(), false);
-	std::vector< glm::vec3 > spin_normal(spin_stack.size(), glm::vec3(0.0f));
-	std::vector< bool > hit_ball(spin_stack.size(), false);
-	
-	spin_angle[1] = (float)(1.0f * M_PI);
-	
-	std::vector< Scene::Object * > ball_stack;
-	ball_stack.emplace_back( &add_object("Ball", glm::vec3(0.0f, 0.0f, 0.2f), glm::quat(0.0f, 0.0f, 0.0f, 1.0f), glm::vec3(0.08f)) );
-	
-	std::vector< glm::vec3 > ball_velocity(ball_stack.size(), glm::vec3(0.0f));
-	std::vector< glm::vec3 > ball_accel(ball_stack.size(), glm::vec3(0.0f));
-	
+	std::vector< Scene::ObjectHandle > spin_stack;
+	spin_stack.emplace_back( add_object("Spin", state.paddles[0].position, glm::quat(0.0f, 0.0f, 0.0f, 1.0f), glm::vec3(0.05f)) );
+	spin_stack.emplace_back( add_object("Spin", state.paddles[1].position, glm::quat(0.0f, 0.0f, 0.0f, -1.0f), glm::vec3(0.05f)) );
+
+	std::vector< Scene::ObjectHandle > ball_stack;
+	ball_stack.emplace_back( add_object("Ball", state.ball.position, glm::quat(0.0f, 0.0f, 0.0f, 1.0f), glm::vec3(0.08f)) );
+
+	//multi-ball mode: extra balls scattered over the field (ball_stack[i + 1] mirrors balls[i]):
+	Balls balls;
+	if (replay) {
+		balls = replay->balls;
+		for (uint32_t i = 0; i < balls.size(); ++i) {
+			ball_stack.emplace_back( add_object("Ball", glm::vec3(balls.x[i], balls.y[i], balls.z[i]), glm::quat(0.0f, 0.0f, 0.0f, 1.0f), glm::vec3(0.08f)) );
+		}
+	} else {
+		std::mt19937 mt(0x5eed);
+		std::uniform_real_distribution< float > along(-2.8f, 2.8f);
+		std::uniform_real_distribution< float > across(-1.4f, 1.4f);
+		for (uint32_t i = 1; i < config.balls; ++i) {
+			balls.add(glm::vec3(along(mt), across(mt), 0.2f));
+			ball_stack.emplace_back( add_object("Ball", glm::vec3(balls.x.back(), balls.y.back(), balls.z.back()), glm::quat(0.0f, 0.0f, 0.0f, 1.0f), glm::vec3(0.08f)) );
+		}
+	}
+
+	//with --record, every tick's inputs are written out as they are played (see Replay.hpp):
+	std::unique_ptr< ReplayWriter > recording;
+	if (!config.record.empty()) {
+		recording.reset(new ReplayWriter(config.record, arena, balls));
+	}
+
+	//networked match: the session owns the rules (it re-runs ticks when it guessed the peer's inputs wrong):
+	std::unique_ptr< UdpSocket > net_socket;
+	std::unique_ptr< NetSession > net;
+	if (networked) {
+		net_socket.reset(new UdpSocket(config.net_port, config.net_peer));
+		net.reset(new NetSession(arena, uint32_t(config.net_player), config.net_delay, *net_socket));
+	}
+
+	//worker threads, for the --ai player's search and the scene's per-frame matrices (one at a time):
+	JobPool pool;
+
+	//--ai: one player is steered by tree search (see Search.hpp):
+	std::unique_ptr< SearchPlayer > ai;
+	if (config.ai != -1) {
+		ai.reset(new SearchPlayer(arena, uint32_t(config.ai), &pool));
+	}
+
+	//for ball-ball collisions:
+	BallGrid ball_grid(-arena.half_size, arena.half_size);
+
+	//winner whose banner has been added to the scene (-1 for none yet):
+	int32_t shown_winner = -1;
+	Scene::ObjectHandle win_banner; //(names nothing until there is a banner)
+
+	//state as of the tick before 'state' (for interpolating the drawn poses):
+	GameState previous_state = state;
+	Balls previous_balls = balls;
+	//frame time not yet simulated:
+	float tick_accumulator = 0.0f;
+
 	glm::vec2 mouse = glm::vec2(0.0f, 0.0f); //mouse position in [-1,1]x[-1,1] coordinates
 
 	struct {
@@ -305,6 +376,18 @@ int main(int argc, char **argv) {
 			} else if (evt.type == SDL_MOUSEBUTTONDOWN) {
 			} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_ESCAPE) {
 				should_quit = true;
+			} else if (evt.type == SDL_KEYDOWN && replay && !recording
+				&& (evt.key.keysym.sym == SDLK_LEFTBRACKET || evt.key.keysym.sym == SDLK_RIGHTBRACKET || evt.key.keysym.sym == SDLK_HOME)) {
+				//scrub through a replay: '[' and ']' jump ten seconds back or ahead, Home to the start
+				// (re-recording a replay plays it straight through, so no jumping then):
+				const uint64_t jump = uint64_t(10.0f / TickElapsed);
+				uint64_t target = 0;
+				if (evt.key.keysym.sym == SDLK_LEFTBRACKET) target = replay->ticks - std::min(replay->ticks, jump);
+				if (evt.key.keysym.sym == SDLK_RIGHTBRACKET) target = std::min(replay->length, replay->ticks + jump);
+				replay->seek(target, &state, &balls);
+				previous_state = state;
+				previous_balls = balls;
+				tick_accumulator = 0.0f;
 			} else if (evt.type == SDL_QUIT) {
 				should_quit = true;
 				break;
@@ -316,177 +399,100 @@ int main(int argc, char **argv) {
 		static auto previous_time = current_time;
 		float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
 		previous_time = current_time;
+		//after a long hitch, drop time instead of trying to catch up all at once:
+		elapsed = std::min(elapsed, 0.25f);
 
 		{ //update game state:
-			//spin stuff
+			GameInputs inputs;
 			// right player
-			if(keystate[SDL_SCANCODE_RIGHT]) {	
-				if(spin_stack[0]->transform.position.x >= -2.95f) {
-					spin_stack[0]->transform.position.x -= 1.2f * elapsed;
-					if(spin_collide_pillars(spin_stack[0]) || spins_collide(spin_stack[0], spin_stack[1])) {
-						spin_stack[0]->transform.position.x += 1.2f * elapsed;
-					}
-				}
-			} else if(keystate[SDL_SCANCODE_LEFT]) {
-				if(spin_stack[0]->transform.position.x <= 2.95f) {
-					spin_stack[0]->transform.position.x += 1.2f * elapsed;
-					if(spin_collide_pillars(spin_stack[0]) || spins_collide(spin_stack[0], spin_stack[1])) {
-						spin_stack[0]->transform.position.x -= 1.2f * elapsed;
-					}
-				}
-			}
-			if(keystate[SDL_SCANCODE_UP]) {	
-				if(spin_stack[0]->transform.position.y >= -1.4f) {
-					spin_stack[0]->transform.position.y -= 1.2f * elapsed;
-					if(spin_collide_pillars(spin_stack[0]) || spins_collide(spin_stack[0], spin_stack[1])) {
-						spin_stack[0]->transform.position.y += 1.2f * elapsed;
-					}
-				}
-			} else if(keystate[SDL_SCANCODE_DOWN]) {
-				if(spin_stack[0]->transform.position.y <= 1.4f) {
-					spin_stack[0]->transform.position.y += 1.2f * elapsed;
-					if(spin_collide_pillars(spin_stack[0]) || spins_collide(spin_stack[0], spin_stack[1])) {
-						spin_stack[0]->transform.position.y -= 1.2f * elapsed;
-					}
-				}
-			}
-			// handle changing the direction of the spinning
-			if(keystate[SDL_SCANCODE_SLASH]) {
-				if(!spin_changing[0]) {
-					spin_cloclwise[0] *= -1.0f;
-				}
-				spin_changing[0] = true;
-			} else {
-				spin_changing[0] = false;
-			}
+			inputs.players[0].right = keystate[SDL_SCANCODE_RIGHT];
+			inputs.players[0].left = keystate[SDL_SCANCODE_LEFT];
+			inputs.players[0].up = keystate[SDL_SCANCODE_UP];
+			inputs.players[0].down = keystate[SDL_SCANCODE_DOWN];
+			inputs.players[0].toggle = keystate[SDL_SCANCODE_SLASH];
 			// left player
-			if(keystate[SDL_SCANCODE_D]) {	
-				if(spin_stack[1]->transform.position.x >= -2.95f) {
-					spin_stack[1]->transform.position.x -= 1.2f * elapsed;
-					if(spin_collide_pillars(spin_stack[1]) || spins_collide(spin_stack[0], spin_stack[1])) {
-						spin_stack[1]->transform.position.x += 1.2f * elapsed;
-					}
-				}
-			} else if(keystate[SDL_SCANCODE_A]) {
-				if(spin_stack[1]->transform.position.x <= 2.95f) {
-					spin_stack[1]->transform.position.x += 1.2f * elapsed;
-					if(spin_collide_pillars(spin_stack[1]) || spins_collide(spin_stack[0], spin_stack[1])) {
-						spin_stack[1]->transform.position.x -= 1.2f * elapsed;
-					}
+			inputs.players[1].right = keystate[SDL_SCANCODE_D];
+			inputs.players[1].left = keystate[SDL_SCANCODE_A];
+			inputs.players[1].up = keystate[SDL_SCANCODE_W];
+			inputs.players[1].down = keystate[SDL_SCANCODE_S];
+			inputs.players[1].toggle = keystate[SDL_SCANCODE_Q];
+			//(decided once per frame, from the latest state, and held for this frame's ticks)
+			if (ai) inputs.players[ai->player] = ai->decide(state);
+
+			//run the rules at a fixed rate, independent of the frame rate:
+			tick_accumulator += elapsed;
+			if (net) {
+				//(shown without interpolation, since a rollback can move things anyway)
+				net->update(inputs.players[net->rollback.local_player], elapsed);
+				state = net->rollback.state;
+				previous_state = state;
+				tick_accumulator = 0.0f;
+			} else if (replay && config.replay_max_speed) {
+				//(as many ticks as fit in most of a 60Hz frame)
+				auto deadline = current_time + std::chrono::milliseconds(14);
+				while (std::chrono::high_resolution_clock::now() < deadline) {
+					if (!replay->next(&inputs)) break;
+					if (recording) recording->record(inputs, state, balls);
+					step(arena, state, balls, ball_grid, inputs, TickElapsed);
 				}
+				//(shown without interpolation, at the newest tick -- so a finished replay shows its last one)
+				previous_state = state;
+				previous_balls = balls;
+				tick_accumulator = 0.0f;
 			}
-			if(keystate[SDL_SCANCODE_W]) {	
-				if(spin_stack[1]->transform.position.y >= -1.4f) {
-					spin_stack[1]->transform.position.y -= 1.2f * elapsed;
-					if(spin_collide_pillars(spin_stack[1]) || spins_collide(spin_stack[0], spin_stack[1])) {
-						spin_stack[1]->transform.position.y += 1.2f * elapsed;
-					}
-				}
-			} else if(keystate[SDL_SCANCODE_S]) {
-				if(spin_stack[1]->transform.position.y <= 1.4f) {
-					spin_stack[1]->transform.position.y += 1.2f * elapsed;
-					if(spin_collide_pillars(spin_stack[1]) || spins_collide(spin_stack[0], spin_stack[1])) {
-						spin_stack[1]->transform.position.y -= 1.2f * elapsed;
-					}
-				}
+			while (tick_accumulator >= TickElapsed) {
+				previous_state = state;
+				previous_balls = balls;
+				//(a finished replay leaves the match frozen where it ended)
+				if (replay && !replay->next(&inputs)) break;
+				if (recording) recording->record(inputs, state, balls);
+				step(arena, state, balls, ball_grid, inputs, TickElapsed);
+				tick_accumulator -= TickElapsed;
 			}
-			
-			// handle changing the direction of the spinning
-			if(keystate[SDL_SCANCODE_Q]) {
-				if(!spin_changing[1]) {
-					spin_cloclwise[1] *= -1.0f;
-				}
-				spin_changing[1] = true;
-			} else {
-				spin_changing[1] = false;
-			}				
-			
+			tick_accumulator = std::min(tick_accumulator, TickElapsed);
+
+			//copy game state to the scene, interpolating between the last two ticks:
+			float amt = tick_accumulator / TickElapsed;
 			for(uint32_t i = 0; i < spin_stack.size(); i++) {
-				// update rotation
-				spin_angle[i] += 5.0f * spin_cloclwise[i] * elapsed;
-				if(spin_angle[i] > 2 * M_PI) {
-					spin_angle[i] -= (float)(2.0f * M_PI);
-				} else if(spin_angle[i] < -2 * M_PI) {
-					spin_angle[i] += (float)(2.0f * M_PI);
-				}
-				spin_stack[i]->transform.rotation = glm::angleAxis(spin_angle[i], glm::vec3(0.0f, 0.0f, 1.0f));
-				// update nornal
-				spin_normal[i] =  -1.0f * spin_cloclwise[i] * glm::normalize(glm::mat4_cast(spin_stack[i]->transform.rotation) * glm::vec4(-1.0f, 0.0f, 0.0f, 1.0f));
-
-				// detect collision with ball
-				if(spin_collide_ball(spin_stack[i], ball_stack[0])) {
-					if(!hit_ball[i]) {
-						ball_velocity[0] += 2.6f * spin_normal[i];
-					}
-					hit_ball[i] = true;
-				} else {
-					hit_ball[i] = false;
-				}
-			}
-			
-			// handle friction on different region
-			if(distance(ball_stack[0]->transform.position, glm::vec3(0.0f)) < 1.0f) {
-				if(std::abs(ball_velocity[0].x) > std::abs(0.001f * normalize(ball_velocity[0]).x)) {
-					ball_velocity[0] -= 0.003f * normalize(ball_velocity[0]);
-				} else {
-					ball_velocity[0] = glm::vec3(0.0f);
-				}
-			} else {
-				if(std::abs(ball_velocity[0].x) > std::abs(0.01f * normalize(ball_velocity[0]).x)) {
-					ball_velocity[0] -= 0.02f * normalize(ball_velocity[0]);
-				} else {
-					ball_velocity[0] = glm::vec3(0.0f);
-				}
-			}
-			
-			// detect collision between the ball and the pillars
-			if(distance(ball_stack[0]->transform.position, glm::vec3(2.0f, 0.0f, 0.2f))<0.2f) {
-				glm::vec3 n = normalize(ball_stack[0]->transform.position - glm::vec3(2.0f, 0.0f, 0.2f));
-				float magnitude = ball_velocity[0].x / normalize(ball_velocity[0]).x;
-				ball_velocity[0] *= 0.8f;
-				ball_velocity[0] += magnitude * n;
-			} else if(distance(ball_stack[0]->transform.position, glm::vec3(-2.0f, 0.0f, 0.2f))<0.2f) {
-				glm::vec3 n = normalize(ball_stack[0]->transform.position - glm::vec3(-2.0f, 0.0f, 0.2f));
-				float magnitude = ball_velocity[0].x / normalize(ball_velocity[0]).x;
-				ball_velocity[0] *= 0.8f;
-				ball_velocity[0] += magnitude * n;
+				glm::quat before = glm::angleAxis(previous_state.paddles[i].angle, glm::vec3(0.0f, 0.0f, 1.0f));
+				glm::quat after = glm::angleAxis(state.paddles[i].angle, glm::vec3(0.0f, 0.0f, 1.0f));
+				scene.objects[spin_stack[i]].transform.set_position(glm::mix(previous_state.paddles[i].position, state.paddles[i].position, amt));
+				scene.objects[spin_stack[i]].transform.set_rotation(glm::slerp(before, after, amt));
 			}
-			ball_stack[0]->transform.position += ball_velocity[0] * elapsed;
-			// detect collision between the ball and walls
-			if(ball_stack[0]->transform.position.y >= 1.52f || ball_stack[0]->transform.position.y <= -1.52) {
-				ball_velocity[0].y *= -1.0f;
+			scene.objects[ball_stack[0]].transform.set_position(glm::mix(previous_state.ball.position, state.ball.position, amt));
+			for(uint32_t i = 0; i < balls.size(); i++) {
+				scene.objects[ball_stack[i + 1]].transform.set_position(glm::mix(
+					glm::vec3(previous_balls.x[i], previous_balls.y[i], previous_balls.z[i]),
+					glm::vec3(balls.x[i], balls.y[i], balls.z[i]),
+					amt));
 			}
-			
-			// determine winning player
-			if(ball_stack[0]->transform.position.x >= 3.1f) {
-				ball_velocity[0] = glm::vec3(0.0f);
-				ball_stack[0]->transform.position = glm::vec3(0.0f, 0.0f, -1.0f);
-				std::vector< Scene::Object * > win_stack;
-				win_stack.emplace_back( &add_object("R_win", glm::vec3(0.0f, 0.8f, 1.8f), glm::quat(0.0f, 0.0f, 0.0f, 1.0f), glm::vec3(2.0f, 1.0f, 1.0f)) );
-				win_stack[0]->transform.rotation = glm::angleAxis(-0.5f, glm::vec3(1.0f, 0.0f, 0.0f));
-			} else if(ball_stack[0]->transform.position.x <= -3.1f) {
-				ball_velocity[0] = glm::vec3(0.0f);
-				ball_stack[0]->transform.position = glm::vec3(0.0f, 0.0f, -1.0f);
-				std::vector< Scene::Object * > win_stack;
-				win_stack.emplace_back( &add_object("L_win", glm::vec3(0.0f, 0.8f, 1.8f), glm::quat(0.0f, 0.0f, 0.0f, 1.0f), glm::vec3(2.0f, 1.0f, 1.0f)) );
-				win_stack[0]->transform.rotation = glm::angleAxis(-0.5f, glm::vec3(1.0f, 0.0f, 0.0f));
+
+			// show the winning player
+			if(state.winner != shown_winner) {
+				shown_winner = state.winner;
+				//(seeking a replay back to before the goal takes the banner down again)
+				if (scene.objects.contains(win_banner)) scene.objects.remove(win_banner);
+				if (shown_winner != -1) {
+					win_banner = add_object(shown_winner == 0 ? "R_win" : "L_win", glm::vec3(0.0f, 0.8f, 1.8f), glm::quat(0.0f, 0.0f, 0.0f, 1.0f), glm::vec3(2.0f, 1.0f, 1.0f));
+					scene.objects[win_banner].transform.set_rotation(glm::angleAxis(-0.5f, glm::vec3(1.0f, 0.0f, 0.0f)));
+				}
 			}
 
 			//camera:
-			scene.camera.transform.position = camera.radius * glm::vec3(
+			scene.camera.transform.set_position(camera.radius * glm::vec3(
 				std::cos(camera.elevation) * std::cos(camera.azimuth),
 				std::cos(camera.elevation) * std::sin(camera.azimuth),
-				std::sin(camera.elevation)) + camera.target;
+				std::sin(camera.elevation)) + camera.target);
 
-			glm::vec3 out = -glm::normalize(camera.target - scene.camera.transform.position);
+			glm::vec3 out = -glm::normalize(camera.target - scene.camera.transform.get_position());
 			glm::vec3 up = glm::vec3(0.0f, 0.0f, 1.0f);
 			up = glm::normalize(up - glm::dot(up, out) * out);
 			glm::vec3 right = glm::cross(up, out);
 			
-			scene.camera.transform.rotation = glm::quat_cast(
+			scene.camera.transform.set_rotation(glm::quat_cast(
 				glm::mat3(right, up, out)
-			);
-			scene.camera.transform.scale = glm::vec3(1.0f, 1.0f, 1.0f);
+			));
+			scene.camera.transform.set_scale(glm::vec3(1.0f, 1.0f, 1.0f));
 		}
 
 		//draw output:
@@ -500,7 +506,9 @@ int main(int argc, char **argv) {
 		{ //draw game state:
 			glUseProgram(program);
 			glUniform3fv(program_to_light, 1, glm::value_ptr(glm::normalize(glm::vec3(0.0f, 0.0f, 2.0f))));
-			scene.render();
+			//(matrices worked out on the pool; this thread just makes the GL calls)
+			scene.prepare(&pool);
+			scene.submit();
 		}
 
 
@@ -5,7 +5,7 @@
 #Note: Script meant to be executed from within blender, as per:
 #blender --background --python export-meshes_spin.py
 
-#reads 'spin.blend' and writes '../dist/meshes_spin.blob' (meshes) and '../dist/scene_spin.blob' (scene in layer 1)
+#reads 'spin.blend' and writes '../dist/meshes_spin.blob' (meshes) and '../dist/scene_spin.blob' (scene in layer 1, plus arena colliders)
 
 import sys
 
@@ -153,5 +153,38 @@ blob.write(struct.pack('4s',b'scn0')) #type
 blob.write(struct.pack('I', len(scene))) #length
 blob.write(scene)
 
+#---------------------------------------------------------------------
+#Export colliders (read by Arena::load):
+# an empty named 'Field' gives the field size (its scale: goal lines at +/- x, side walls at +/- y);
+# empties named 'Pillar...' give pillar centres (location) and sizes (scale x: how close balls get,
+# scale y: how close spin stuff get). Without them, the original field is written.
+
+colliders = b''
+field = (3.1, 1.52)
+if 'Field' in bpy.data.objects:
+	scale = bpy.data.objects['Field'].scale
+	field = (scale.x, scale.y)
+colliders += struct.pack('I', 0) #type: field
+colliders += struct.pack('3f', 0.0, 0.0, 0.0)
+colliders += struct.pack('2f', 0.0, 0.0)
+colliders += struct.pack('2f', field[0], field[1])
+
+pillars = []
+for obj in bpy.data.objects:
+	if not obj.name.startswith('Pillar'): continue
+	pillars.append((obj.location.x, obj.location.y, obj.location.z, obj.scale.x, obj.scale.y))
+if len(pillars) == 0:
+	pillars = [(2.0, 0.0, 0.2, 0.2, 0.38), (-2.0, 0.0, 0.2, 0.2, 0.38)]
+for (x, y, z, radius, reach) in pillars:
+	colliders += struct.pack('I', 1) #type: pillar
+	colliders += struct.pack('3f', x, y, z)
+	colliders += struct.pack('2f', radius, reach)
+	colliders += struct.pack('2f', 0.0, 0.0)
+
+#third chunk: the colliders
+blob.write(struct.pack('4s',b'col0')) #type
+blob.write(struct.pack('I', len(colliders))) #length
+blob.write(colliders)
+
 print("Wrote " + str(blob.tell()) + " bytes to scene_spin.blob")
 
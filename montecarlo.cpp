@@ -0,0 +1,243 @@
+//Plays lots of headless matches on every core and reports how they went,
+// for balance testing the tuning constants.
+// usage: montecarlo [--matches N] [--threads N] [--p0 random|chase|idle] [--p1 random|chase|idle]
+//                   [--max-seconds S] [--seed N] [--batch N]
+//                   [--inner-friction F] [--outer-friction F] [--inner-stop F] [--outer-stop F]
+//                   [--paddle-speed F] [--hit-impulse F]
+
+#include "Game.hpp"
+#include "Bot.hpp"
+#include "JobPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+//seconds since 'start':
+static double since(std::chrono::high_resolution_clock::time_point const &start) {
+	return std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+enum Controller : uint8_t {
+	Random,
+	Chase,
+	Idle,
+};
+
+static char const *controller_name(Controller controller) {
+	if (controller == Random) return "random";
+	if (controller == Chase) return "chase";
+	return "idle";
+}
+
+struct Config {
+	uint64_t matches = 100000;
+	uint32_t threads = 0; //0 = one per core
+	uint32_t batch = 64; //matches per job
+	float max_seconds = 60.0f; //matches still going after this long count as unfinished
+	uint64_t seed = 1;
+	Controller players[2] = { Random, Random };
+	Arena arena;
+};
+
+//Everything counted about a group of matches:
+struct Tally {
+	static constexpr float BucketSeconds = 0.25f; //match length histogram resolution
+
+	uint64_t matches = 0;
+	uint64_t wins[2] = {0, 0};
+	uint64_t unfinished = 0;
+	uint64_t ticks = 0;
+	uint64_t hits[2] = {0, 0};
+	std::vector< uint64_t > lengths; //lengths[i]: matches ending in bucket i
+
+	void add(Tally const &other) {
+		matches += other.matches;
+		for (uint32_t p = 0; p < 2; ++p) {
+			wins[p] += other.wins[p];
+			hits[p] += other.hits[p];
+		}
+		unfinished += other.unfinished;
+		ticks += other.ticks;
+		if (lengths.size() < other.lengths.size()) lengths.resize(other.lengths.size(), 0);
+		for (uint32_t i = 0; i < other.lengths.size(); ++i) {
+			lengths[i] += other.lengths[i];
+		}
+	}
+
+	//finished match length (in seconds) that fraction 'f' of them are no longer than:
+	float length_percentile(float f) const {
+		uint64_t want = uint64_t(f * (wins[0] + wins[1]));
+		uint64_t seen = 0;
+		for (uint32_t i = 0; i < lengths.size(); ++i) {
+			seen += lengths[i];
+			if (seen > want) return (i + 1) * BucketSeconds;
+		}
+		return lengths.size() * BucketSeconds;
+	}
+};
+constexpr float Tally::BucketSeconds;
+
+static PlayerInput control(Controller controller, GameState const &state, uint32_t player, std::mt19937 &mt, uint32_t tick, PlayerInput const &held) {
+	if (controller == Chase) return chase_ball(state, player);
+	if (controller == Idle) return PlayerInput();
+	//random: mash a new set of keys every 1/3 second or so
+	if (tick % 80 != 0) return held;
+	uint32_t b = mt();
+	PlayerInput input;
+	input.left = (b & 1);
+	input.right = (b & 2);
+	input.up = (b & 4);
+	input.down = (b & 8);
+	input.toggle = (b & 16);
+	return input;
+}
+
+//play one match (its random inputs come from its own index, so results don't depend on threading):
+static void play_match(Config const &config, uint64_t index, Tally *tally) {
+	std::seed_seq seeds{ uint32_t(config.seed), uint32_t(config.seed >> 32), uint32_t(index), uint32_t(index >> 32) };
+	std::mt19937 mt(seeds);
+	const uint32_t MaxTicks = uint32_t(config.max_seconds / TickElapsed);
+
+	GameState state;
+	GameInputs inputs;
+	uint32_t tick = 0;
+	for (; tick < MaxTicks && state.winner == -1; ++tick) {
+		for (uint32_t p = 0; p < 2; ++p) {
+			inputs.players[p] = control(config.players[p], state, p, mt, tick, inputs.players[p]);
+		}
+		uint8_t was_hit = state.ball.hit;
+		step(config.arena, state, inputs, TickElapsed);
+		uint8_t new_hits = state.ball.hit & ~was_hit;
+		tally->hits[0] += (new_hits & 1);
+		tally->hits[1] += (new_hits >> 1) & 1;
+	}
+
+	tally->matches += 1;
+	tally->ticks += tick;
+	if (state.winner == -1) {
+		tally->unfinished += 1;
+	} else {
+		tally->wins[state.winner] += 1;
+		uint32_t bucket = uint32_t(tick * TickElapsed / Tally::BucketSeconds);
+		if (tally->lengths.size() <= bucket) tally->lengths.resize(bucket + 1, 0);
+		tally->lengths[bucket] += 1;
+	}
+}
+
+static bool parse_controller(std::string const &name, Controller *controller) {
+	if (name == "random") *controller = Random;
+	else if (name == "chase") *controller = Chase;
+	else if (name == "idle") *controller = Idle;
+	else return false;
+	return true;
+}
+
+int main(int argc, char **argv) {
+	Config config;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		bool has_value = (argi + 1 < argc);
+		std::string value = (has_value ? argv[argi + 1] : "");
+		Tuning &tuning = config.arena.tuning;
+		bool ok = true;
+		if (!has_value) {
+			ok = false;
+		} else if (arg == "--matches") {
+			config.matches = std::strtoull(value.c_str(), nullptr, 10);
+		} else if (arg == "--threads") {
+			config.threads = uint32_t(std::atoi(value.c_str()));
+		} else if (arg == "--batch") {
+			config.batch = std::max(1, std::atoi(value.c_str()));
+		} else if (arg == "--max-seconds") {
+			config.max_seconds = float(std::atof(value.c_str()));
+		} else if (arg == "--seed") {
+			config.seed = std::strtoull(value.c_str(), nullptr, 10);
+		} else if (arg == "--p0") {
+			ok = parse_controller(value, &config.players[0]);
+		} else if (arg == "--p1") {
+			ok = parse_controller(value, &config.players[1]);
+		} else if (arg == "--inner-friction") {
+			tuning.inner_friction = float(std::atof(value.c_str()));
+		} else if (arg == "--outer-friction") {
+			tuning.outer_friction = float(std::atof(value.c_str()));
+		} else if (arg == "--inner-stop") {
+			tuning.inner_stop = float(std::atof(value.c_str()));
+		} else if (arg == "--outer-stop") {
+			tuning.outer_stop = float(std::atof(value.c_str()));
+		} else if (arg == "--paddle-speed") {
+			tuning.paddle_speed = float(std::atof(value.c_str()));
+		} else if (arg == "--hit-impulse") {
+			tuning.hit_impulse = float(std::atof(value.c_str()));
+		} else {
+			ok = false;
+		}
+		if (!ok) {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--matches N] [--threads N] [--p0 random|chase|idle] [--p1 random|chase|idle]\n"
+				"\t\t[--max-seconds S] [--seed N] [--batch N]\n"
+				"\t\t[--inner-friction F] [--outer-friction F] [--inner-stop F] [--outer-stop F]\n"
+				"\t\t[--paddle-speed F] [--hit-impulse F]" << std::endl;
+			return 1;
+		}
+		++argi;
+	}
+
+	JobPool pool(config.threads);
+	Tuning const &tuning = config.arena.tuning;
+	std::cout << "montecarlo: " << config.matches << " matches, right player (p0) " << controller_name(config.players[0])
+		<< " vs left player (p1) " << controller_name(config.players[1]) << ", " << pool.size() << " threads" << std::endl;
+	std::cout << "  tuning: friction " << tuning.inner_friction << " / " << tuning.outer_friction
+		<< " (stop " << tuning.inner_stop << " / " << tuning.outer_stop << "), paddle speed " << tuning.paddle_speed
+		<< ", hit impulse " << tuning.hit_impulse << std::endl;
+
+	//one tally per batch, merged at the end (so nothing is shared while playing):
+	uint64_t batches = (config.matches + config.batch - 1) / config.batch;
+	std::vector< Tally > tallies(batches);
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint64_t b = 0; b < batches; ++b) {
+		pool.submit([&config, &tallies, b]() {
+			Tally tally; //(local while playing, so threads don't share cache lines)
+			uint64_t end = std::min(config.matches, (b + 1) * config.batch);
+			for (uint64_t m = b * config.batch; m < end; ++m) {
+				play_match(config, m, &tally);
+			}
+			tallies[b] = tally;
+		});
+	}
+	pool.wait();
+	double seconds = since(start);
+
+	Tally total;
+	for (auto const &tally : tallies) {
+		total.add(tally);
+	}
+	if (total.matches == 0) return 0;
+
+	double per_match = 100.0 / total.matches;
+	uint64_t finished = total.wins[0] + total.wins[1];
+	//(more threads than cores don't make more cores)
+	uint32_t cores = std::min(pool.size(), std::max(1U, std::thread::hardware_concurrency()));
+	std::cout << "  throughput: " << (total.matches / seconds / cores) << " matches/sec/core on " << cores << " cores ("
+		<< (total.matches / seconds) << " matches/sec overall, " << (total.ticks / seconds / 1e6) << "M ticks/sec, "
+		<< seconds << "s, " << pool.steals() << " jobs stolen)" << std::endl;
+	std::cout << "  wins: right " << (total.wins[0] * per_match) << "%, left " << (total.wins[1] * per_match)
+		<< "%, unfinished after " << config.max_seconds << "s " << (total.unfinished * per_match) << "%" << std::endl;
+	if (finished) {
+		double mean = 0.0; //(from bucket centres)
+		for (uint32_t i = 0; i < total.lengths.size(); ++i) {
+			mean += total.lengths[i] * (i + 0.5) * Tally::BucketSeconds;
+		}
+		std::cout << "  finished match length: mean " << (mean / finished) << "s; p10 " << total.length_percentile(0.1f)
+			<< "s, p50 " << total.length_percentile(0.5f) << "s, p90 " << total.length_percentile(0.9f)
+			<< "s, p99 " << total.length_percentile(0.99f) << "s" << std::endl;
+	}
+	std::cout << "  hits per match: right " << (double(total.hits[0]) / total.matches)
+		<< ", left " << (double(total.hits[1]) / total.matches) << std::endl;
+
+	return 0;
+}
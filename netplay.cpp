@@ -0,0 +1,164 @@
+//One end of a networked match played by a bot, for testing rollback netcode on one
+// machine: run two of these (one per player) pointed at each other over loopback,
+// with made-up latency and loss, and each reports what rollback cost it and
+// whether the two ended up with the same match.
+// usage: netplay --player 0|1 --port P --peer HOST:PORT [--seconds S] [--delay TICKS]
+//                [--latency MS] [--jitter MS] [--loss F] [--outage START_S LENGTH_S]
+//                [--bot random|chase] [--seed N]
+// e.g.:  netplay --player 0 --port 7000 --peer 127.0.0.1:7001 --latency 50 --loss 0.05 &
+//        netplay --player 1 --port 7001 --peer 127.0.0.1:7000 --latency 50 --loss 0.05
+// (--outage drops everything this end sends for a while; give it to one end only to cut
+//  the link in one direction)
+
+#include "Net.hpp"
+#include "Bot.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+int main(int argc, char **argv) {
+	struct {
+		int32_t player = -1;
+		int32_t port = -1;
+		std::string peer;
+		float seconds = 30.0f;
+		uint32_t delay = 2;
+		LinkConditions conditions;
+		bool chase = false;
+		uint32_t seed = 0;
+	} config;
+
+	bool ok = true;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		bool has_value = (argi + 1 < argc);
+		std::string value = (has_value ? argv[argi + 1] : "");
+		if (!has_value) {
+			ok = false;
+		} else if (arg == "--player") {
+			config.player = std::atoi(value.c_str());
+		} else if (arg == "--port") {
+			config.port = std::atoi(value.c_str());
+		} else if (arg == "--peer") {
+			config.peer = value;
+		} else if (arg == "--seconds") {
+			config.seconds = float(std::atof(value.c_str()));
+		} else if (arg == "--delay") {
+			config.delay = uint32_t(std::atoi(value.c_str()));
+		} else if (arg == "--latency") {
+			config.conditions.latency = float(std::atof(value.c_str())) / 1000.0f;
+		} else if (arg == "--jitter") {
+			config.conditions.jitter = float(std::atof(value.c_str())) / 1000.0f;
+		} else if (arg == "--loss") {
+			config.conditions.loss = float(std::atof(value.c_str()));
+		} else if (arg == "--outage") {
+			if (argi + 2 >= argc) {
+				ok = false;
+				break;
+			}
+			config.conditions.outage_start = float(std::atof(value.c_str()));
+			config.conditions.outage_length = float(std::atof(argv[argi + 2]));
+			++argi;
+		} else if (arg == "--bot") {
+			config.chase = (value == "chase");
+			ok = (value == "chase" || value == "random");
+		} else if (arg == "--seed") {
+			config.seed = uint32_t(std::atoi(value.c_str()));
+		} else {
+			ok = false;
+		}
+		if (!ok) break;
+		++argi;
+	}
+	if (!ok || !(config.player == 0 || config.player == 1) || !(config.port > 0 && config.port < 65536) || config.peer.empty()
+		|| config.delay >= Rollback::MaxPrediction) {
+		std::cerr << "Usage:\n\t" << argv[0] << " --player 0|1 --port P --peer HOST:PORT [--seconds S] [--delay TICKS]\n"
+			"\t\t[--latency MS] [--jitter MS] [--loss F] [--outage START_S LENGTH_S]\n"
+			"\t\t[--bot random|chase] [--seed N]" << std::endl;
+		return 1;
+	}
+
+	UdpSocket socket(uint16_t(config.port), config.peer);
+	socket.conditions = config.conditions;
+	Arena arena;
+	NetSession session(arena, uint32_t(config.player), config.delay, socket);
+	session.stop_at = uint32_t(config.seconds / TickElapsed);
+
+	std::cout << "netplay: player " << config.player << " on port " << config.port << " vs " << config.peer
+		<< "; " << session.stop_at << " ticks, input delay " << config.delay << ", latency " << config.conditions.latency * 1000.0f
+		<< "+" << config.conditions.jitter * 1000.0f << "ms, loss " << config.conditions.loss * 100.0f << "%";
+	if (config.conditions.outage_length > 0.0f) {
+		std::cout << ", sending nothing from " << config.conditions.outage_start << "s for " << config.conditions.outage_length << "s";
+	}
+	std::cout << std::endl;
+
+	//the bot's inputs only have to be plausible, not reproducible (the peer is sent whatever we do):
+	std::mt19937 mt(config.seed + uint32_t(config.player));
+	PlayerInput held;
+
+	const auto FrameTime = std::chrono::microseconds(16667); //60Hz, like the game
+	auto previous = std::chrono::steady_clock::now();
+	auto next_frame = previous;
+	auto give_up = previous + std::chrono::duration_cast< std::chrono::steady_clock::duration >(std::chrono::duration< float >(config.seconds * 2.0f + 10.0f));
+	while (true) {
+		auto now = std::chrono::steady_clock::now();
+		if (now > give_up) {
+			std::cerr << "Gave up waiting for the peer." << std::endl;
+			break;
+		}
+		float elapsed = std::chrono::duration< float >(now - previous).count();
+		previous = now;
+
+		Rollback const &rollback = session.rollback;
+		if (config.chase) {
+			held = chase_ball(rollback.state, uint32_t(config.player));
+		} else if (rollback.tick % 80 < 4) {
+			uint32_t b = mt();
+			held.left = (b & 1);
+			held.right = (b & 2);
+			held.up = (b & 4);
+			held.down = (b & 8);
+			held.toggle = (b & 16);
+		}
+		session.update(held, elapsed);
+
+		//done once our match is over and final, and the peer has everything it needs to finish too:
+		if (rollback.tick == session.stop_at && rollback.remote_confirmed >= session.stop_at
+			&& session.remote_ack >= rollback.local_end()) {
+			break;
+		}
+
+		next_frame += FrameTime;
+		std::this_thread::sleep_until(next_frame);
+	}
+	//(keep answering for a moment in case our last packets were lost)
+	for (uint32_t i = 0; i < 30; ++i) {
+		session.exchange();
+		std::this_thread::sleep_for(FrameTime);
+	}
+
+	NetSession::Stats const &stats = session.stats;
+	uint32_t checksum = 0;
+	bool final = session.rollback.final_checksum(session.rollback.tick, &checksum);
+	std::cout << "  final: tick " << session.rollback.tick << " checksum ";
+	if (final) std::cout << std::hex << checksum << std::dec;
+	else std::cout << "(not final)";
+	std::cout << ", winner " << session.rollback.state.winner << std::endl;
+	std::cout << "  checksums: " << stats.checks << " matched the peer's, " << stats.desyncs << " desyncs" << std::endl;
+	std::cout << "  rollback: " << stats.rollbacks << " of " << stats.frames << " frames re-simulated; "
+		<< (stats.rollbacks ? double(stats.resimulated) / stats.rollbacks : 0.0) << " ticks per rollback (most " << stats.most_resimulated << "); "
+		<< "re-simulation cost " << (stats.resimulate_seconds / std::max< uint64_t >(1, stats.frames) * 1e6) << " us/frame average, "
+		<< (stats.most_resimulate_seconds * 1e6) << " us worst frame" << std::endl;
+	std::cout << "  timing: " << stats.prediction_stalls << " frames stalled waiting for inputs, " << stats.ack_stalls
+		<< " waiting for acknowledgements, " << stats.sync_waits
+		<< " ticks waited for the peer to catch up" << std::endl;
+	std::cout << "  packets: " << socket.sent << " sent (" << socket.dropped << " dropped on purpose), "
+		<< stats.packets_received << " received" << std::endl;
+
+	return (stats.desyncs == 0 && final) ? 0 : 1;
+}
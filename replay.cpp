@@ -0,0 +1,119 @@
+//Plays a recording (made with main's --record) without drawing anything, as fast
+// as it will go, and reports how long it took and how the match ended. Recordings
+// of real matches make good benchmarks and regression checks for the rules: the
+// same recording should end the same way every time -- and with the same hash (of
+// every tick's state, see roll_hash in Game.hpp) on every machine and build.
+// With --seeks, also jumps to N random ticks (see ReplayReader::seek) and checks each
+// lands on the same state as playing straight there.
+// usage: replay FILE [--realtime] [--loops N] [--seeks N]
+
+#include "Replay.hpp"
+#include "BallGrid.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+//seconds since 'start':
+static double since(std::chrono::high_resolution_clock::time_point const &start) {
+	return std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+	std::string filename;
+	bool realtime = false;
+	uint32_t loops = 1;
+	uint32_t seeks = 0;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--realtime") {
+			realtime = true;
+		} else if (arg == "--loops" && argi + 1 < argc) {
+			loops = std::max(1, std::atoi(argv[++argi]));
+		} else if (arg == "--seeks" && argi + 1 < argc) {
+			seeks = std::max(0, std::atoi(argv[++argi]));
+		} else if (filename.empty() && arg.substr(0, 2) != "--") {
+			filename = arg;
+		} else {
+			filename = "";
+			break;
+		}
+	}
+	if (filename.empty()) {
+		std::cerr << "Usage:\n\t" << argv[0] << " FILE [--realtime] [--loops N] [--seeks N]" << std::endl;
+		return 1;
+	}
+
+	uint32_t first_hash = 0;
+	for (uint32_t loop = 0; loop < loops; ++loop) {
+		ReplayReader replay(filename);
+		GameState state;
+		Balls balls = replay.balls;
+		BallGrid grid(-replay.arena.half_size, replay.arena.half_size);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		GameInputs inputs;
+		uint32_t hash = 0;
+		while (replay.next(&inputs)) {
+			//(the same step main uses, so it ends the same way it did when recorded)
+			step(replay.arena, state, balls, grid, inputs, TickElapsed);
+			hash = roll_hash(hash, state_hash(state));
+			if (balls.size()) hash = roll_hash(hash, balls_hash(balls));
+			if (realtime) {
+				std::this_thread::sleep_until(start + std::chrono::duration< double >(replay.ticks * double(TickElapsed)));
+			}
+		}
+		double seconds = since(start);
+
+		std::cout << filename << ": " << replay.ticks << " ticks (" << (replay.ticks * TickElapsed) << "s of play, "
+			<< 1 + balls.size() << " balls) in " << seconds << "s, " << (replay.ticks / seconds) << " ticks/sec" << std::endl;
+		std::cout << "  winner: " << (state.winner == 0 ? "right" : state.winner == 1 ? "left" : "none")
+			<< "; ball at " << state.ball.position.x << ", " << state.ball.position.y
+			<< "; hash " << std::hex << std::setw(8) << std::setfill('0') << hash << std::dec << std::setfill(' ') << std::endl;
+		if (loop == 0) first_hash = hash;
+		else if (hash != first_hash) std::cout << "  (hash differs from the first loop's: the rules aren't deterministic!)" << std::endl;
+	}
+
+	if (seeks) {
+		//hash of the state at the start of every tick, played straight through:
+		ReplayReader replay(filename);
+		GameState state;
+		Balls balls = replay.balls;
+		BallGrid grid(-replay.arena.half_size, replay.arena.half_size);
+		auto tick_hash = [&]() {
+			return roll_hash(state_hash(state), balls.size() ? balls_hash(balls) : 0);
+		};
+		std::vector< uint32_t > hashes;
+		GameInputs inputs;
+		hashes.emplace_back(tick_hash());
+		while (replay.next(&inputs)) {
+			step(replay.arena, state, balls, grid, inputs, TickElapsed);
+			hashes.emplace_back(tick_hash());
+		}
+
+		std::mt19937 mt(0x5eed);
+		double total = 0.0, worst = 0.0;
+		uint32_t mismatches = 0;
+		for (uint32_t s = 0; s < seeks; ++s) {
+			uint64_t tick = uint64_t(mt()) % hashes.size();
+			auto start = std::chrono::high_resolution_clock::now();
+			bool reached = replay.seek(tick, &state, &balls);
+			double seconds = since(start);
+			total += seconds;
+			worst = std::max(worst, seconds);
+			if (!reached || tick_hash() != hashes[tick]) mismatches += 1;
+		}
+		std::cout << "  " << seeks << " seeks (" << replay.index.size() << " keyframes, one every " << replay.keyframe_ticks << " ticks): "
+			<< (total / seeks * 1000.0) << "ms each on average, " << (worst * 1000.0) << "ms at worst; "
+			<< mismatches << " landed on a different state than playing straight there" << std::endl;
+	}
+
+	return 0;
+}
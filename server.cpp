@@ -0,0 +1,472 @@
+//Headless, authoritative match server: hosts thousands of matches in one process,
+// with no window or GL context. Matches are split into shards, one per worker
+// thread; each shard has its own UDP port, epoll loop, and 240Hz tick timer, so
+// shards never share anything while running. Clients just send their held
+// controls (see ServerProtocol.hpp); the server runs the same rules as main.cpp
+// and sends each match's state back to its players.
+//
+// --bots N fills N matches with scripted players (no network traffic), which is
+// a quick way to see how many matches a core can carry; dist/loadgen drives real
+// matches over loopback.
+//
+// usage: server [--port P] [--shards N] [--slots N] [--bots N] [--seconds S] [--report S]
+
+#ifndef __linux__
+#error "server is built on epoll, timerfd, and recvmmsg/sendmmsg, so is Linux-only"
+#endif
+
+#include "Game.hpp"
+#include "Bot.hpp"
+#include "Replay.hpp"
+#include "ServerProtocol.hpp"
+#include "Histogram.hpp"
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+//ticks a client can go unheard before its place is given up:
+static const uint32_t ClientTimeout = uint32_t(5.0f / TickElapsed);
+//states are sent every this many ticks (60Hz):
+static const uint32_t SendEvery = 4;
+//most ticks run in one wakeup when the timer has fired several times (the rest are dropped):
+static const uint32_t MaxCatchUp = 4;
+
+struct ShardStats {
+	uint64_t ticks = 0;
+	uint64_t missed = 0; //timer expirations dropped instead of run
+	uint64_t packets_in = 0, packets_out = 0;
+	uint64_t finished = 0; //matches that reached a winner
+	double busy = 0.0; //seconds spent working (not waiting in epoll)
+	Histogram lateness; //how late ticks started
+	//as of the latest publish (not summed over time):
+	uint32_t matches = 0, clients = 0;
+
+	void add(ShardStats const &other) {
+		ticks += other.ticks;
+		missed += other.missed;
+		packets_in += other.packets_in;
+		packets_out += other.packets_out;
+		finished += other.finished;
+		busy += other.busy;
+		lateness.add(other.lateness);
+		matches = other.matches;
+		clients = other.clients;
+	}
+};
+
+struct Client {
+	sockaddr_in address;
+	bool joined = false;
+	uint32_t heard = 0; //shard tick of its latest packet
+	uint32_t sequence = 0;
+	PlayerInput input;
+};
+
+struct Match {
+	bool active = false;
+	bool bot = false; //played by chase_ball (right) vs random mashing (left)
+	GameState state;
+	uint32_t tick = 0;
+	uint32_t restart_at = -1U; //after someone wins, the next match starts at this tick
+	Client clients[2];
+	PlayerInput bot_held; //(for the random bot)
+};
+
+struct Shard {
+	Shard(uint32_t index, uint32_t shards, uint16_t port, uint32_t slots);
+	~Shard();
+
+	uint32_t index, shards; //this shard has matches index, index + shards, index + 2 * shards, ...
+	std::vector< Match > matches; //matches[slot] is match (slot * shards + index)
+	Arena arena;
+
+	void run(std::atomic< bool > const &quit);
+
+	//stats since the reporting thread last took them:
+	std::mutex published_lock;
+	ShardStats published;
+
+	std::thread thread;
+
+private:
+	int socket_fd = -1, timer_fd = -1, epoll_fd = -1;
+	uint32_t tick = 0;
+	std::mt19937 mt;
+	ShardStats stats; //not yet published
+
+	void receive();
+	void step_matches();
+	void send_states();
+	void publish();
+};
+
+Shard::Shard(uint32_t index_, uint32_t shards_, uint16_t port, uint32_t slots) : index(index_), shards(shards_), matches(slots), mt(index_) {
+	socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+	if (socket_fd < 0) throw std::runtime_error("Failed to create socket");
+	int yes = 1;
+	setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+	int buffer = 4 << 20; //(a second of packets from a few thousand clients)
+	setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+	setsockopt(socket_fd, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+	sockaddr_in local;
+	std::memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(port);
+	if (bind(socket_fd, reinterpret_cast< sockaddr const * >(&local), sizeof(local)) != 0) {
+		throw std::runtime_error("Failed to bind UDP port " + std::to_string(port));
+	}
+
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	if (timer_fd < 0) throw std::runtime_error("Failed to create tick timer");
+
+	epoll_fd = epoll_create1(0);
+	if (epoll_fd < 0) throw std::runtime_error("Failed to create epoll instance");
+	for (int fd : {socket_fd, timer_fd}) {
+		epoll_event event;
+		std::memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.fd = fd;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) throw std::runtime_error("Failed to add to epoll");
+	}
+}
+
+Shard::~Shard() {
+	if (epoll_fd >= 0) close(epoll_fd);
+	if (timer_fd >= 0) close(timer_fd);
+	if (socket_fd >= 0) close(socket_fd);
+}
+
+void Shard::run(std::atomic< bool > const &quit) {
+	const auto Period = std::chrono::nanoseconds(uint64_t(TickElapsed * 1e9));
+	itimerspec spec;
+	spec.it_interval.tv_sec = 0;
+	spec.it_interval.tv_nsec = long(Period.count());
+	spec.it_value = spec.it_interval;
+	auto start = Clock::now();
+	timerfd_settime(timer_fd, 0, &spec, nullptr);
+	uint64_t expirations = 0; //timer expirations seen so far
+
+	while (!quit.load()) {
+		epoll_event events[2];
+		int count = epoll_wait(epoll_fd, events, 2, 100);
+		auto woke = Clock::now();
+		for (int e = 0; e < count; ++e) {
+			if (events[e].data.fd == socket_fd) {
+				receive();
+			} else if (events[e].data.fd == timer_fd) {
+				uint64_t fired = 0;
+				if (read(timer_fd, &fired, sizeof(fired)) != sizeof(fired) || fired == 0) continue;
+				//the first of these was due at start + (expirations + 1) * Period:
+				auto due = start + Period * (expirations + 1);
+				expirations += fired;
+				stats.lateness.add(std::chrono::duration< double >(woke - due).count());
+
+				uint64_t run = std::min< uint64_t >(fired, MaxCatchUp);
+				stats.missed += fired - run;
+				for (uint64_t r = 0; r < run; ++r) {
+					step_matches();
+				}
+			}
+		}
+		stats.busy += std::chrono::duration< double >(Clock::now() - woke).count();
+	}
+	publish();
+}
+
+void Shard::receive() {
+	const uint32_t Batch = 64;
+	ClientPacket packets[Batch];
+	sockaddr_in from[Batch];
+	iovec iovecs[Batch];
+	mmsghdr messages[Batch];
+	while (true) {
+		for (uint32_t i = 0; i < Batch; ++i) {
+			iovecs[i].iov_base = &packets[i];
+			iovecs[i].iov_len = sizeof(ClientPacket);
+			std::memset(&messages[i], 0, sizeof(messages[i]));
+			messages[i].msg_hdr.msg_iov = &iovecs[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+			messages[i].msg_hdr.msg_name = &from[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(from[i]);
+		}
+		int got = recvmmsg(socket_fd, messages, Batch, MSG_DONTWAIT, nullptr);
+		if (got <= 0) break;
+		stats.packets_in += uint32_t(got);
+
+		for (int i = 0; i < got; ++i) {
+			ClientPacket const &packet = packets[i];
+			if (messages[i].msg_len != sizeof(ClientPacket)) continue;
+			if (std::memcmp(packet.magic, ClientPacket().magic, 4) != 0) continue;
+			if (packet.match % shards != index || packet.match / shards >= matches.size() || packet.player > 1) continue;
+			Match &match = matches[packet.match / shards];
+			if (match.bot) continue;
+
+			Client &client = match.clients[packet.player];
+			bool same = client.joined && client.address.sin_addr.s_addr == from[i].sin_addr.s_addr
+				&& client.address.sin_port == from[i].sin_port;
+			if (!same) {
+				if (client.joined && tick - client.heard < ClientTimeout) continue; //(someone else has that place)
+				client = Client();
+				client.joined = true;
+				client.address = from[i];
+				client.sequence = packet.sequence;
+			}
+			if (!match.active) {
+				match.active = true;
+				match.state = GameState();
+				match.tick = 0;
+				match.restart_at = -1U;
+			}
+			client.heard = tick;
+			if (int32_t(packet.sequence - client.sequence) >= 0) { //(ignore packets that arrive after newer ones)
+				client.sequence = packet.sequence;
+				client.input = unpack_inputs(packet.input).players[0];
+			}
+		}
+		if (uint32_t(got) < Batch) break;
+	}
+}
+
+void Shard::step_matches() {
+	for (auto &match : matches) {
+		if (!match.active) continue;
+		GameInputs inputs;
+		if (match.bot) {
+			inputs.players[0] = chase_ball(match.state, 0);
+			if (match.tick % 80 == 0) {
+				uint32_t b = mt();
+				match.bot_held.left = (b & 1);
+				match.bot_held.right = (b & 2);
+				match.bot_held.up = (b & 4);
+				match.bot_held.down = (b & 8);
+				match.bot_held.toggle = (b & 16);
+			}
+			inputs.players[1] = match.bot_held;
+		} else {
+			for (uint32_t p = 0; p < 2; ++p) {
+				if (match.clients[p].joined) inputs.players[p] = match.clients[p].input;
+			}
+		}
+
+		int32_t winner = match.state.winner;
+		step(arena, match.state, inputs, TickElapsed);
+		match.tick += 1;
+		if (winner == -1 && match.state.winner != -1) {
+			stats.finished += 1;
+			match.restart_at = match.tick + uint32_t(1.0f / TickElapsed); //(a second to show who won)
+		}
+		if (match.tick >= match.restart_at) {
+			match.state = GameState();
+			match.tick = 0;
+			match.restart_at = -1U;
+		}
+	}
+	tick += 1;
+	stats.ticks += 1;
+
+	if (tick % SendEvery == 0) send_states();
+
+	if (tick % 240 == 0) {
+		//let go of clients that went quiet, and matches with nobody left:
+		for (auto &match : matches) {
+			if (!match.active || match.bot) continue;
+			for (auto &client : match.clients) {
+				if (client.joined && tick - client.heard >= ClientTimeout) client.joined = false;
+			}
+			if (!match.clients[0].joined && !match.clients[1].joined) match.active = false;
+		}
+	}
+	if (tick % 24 == 0) publish(); //(10 times a second, so reports line up with their intervals)
+}
+
+void Shard::send_states() {
+	const uint32_t Batch = 64;
+	ServerPacket packets[Batch];
+	iovec iovecs[Batch];
+	mmsghdr messages[Batch];
+	uint32_t queued = 0;
+	auto flush = [&]() {
+		uint32_t done = 0;
+		while (done < queued) {
+			int sent = sendmmsg(socket_fd, messages + done, queued - done, MSG_DONTWAIT);
+			if (sent <= 0) break; //(send buffer full: the rest are lost, as they might have been anyway)
+			done += uint32_t(sent);
+		}
+		stats.packets_out += done;
+		queued = 0;
+	};
+
+	for (uint32_t slot = 0; slot < matches.size(); ++slot) {
+		Match &match = matches[slot];
+		if (!match.active || match.bot) continue;
+		for (auto &client : match.clients) {
+			if (!client.joined) continue;
+			ServerPacket &packet = packets[queued];
+			packet = ServerPacket();
+			packet.match = slot * shards + index;
+			packet.tick = match.tick;
+			packet.ack = client.sequence;
+			for (uint32_t p = 0; p < 2; ++p) {
+				packet.paddle_x[p] = match.state.paddles[p].position.x;
+				packet.paddle_y[p] = match.state.paddles[p].position.y;
+				packet.paddle_angle[p] = match.state.paddles[p].angle;
+			}
+			packet.ball_x = match.state.ball.position.x;
+			packet.ball_y = match.state.ball.position.y;
+			packet.ball_vx = match.state.ball.velocity.x;
+			packet.ball_vy = match.state.ball.velocity.y;
+			packet.winner = match.state.winner;
+
+			iovecs[queued].iov_base = &packet;
+			iovecs[queued].iov_len = sizeof(packet);
+			std::memset(&messages[queued], 0, sizeof(messages[queued]));
+			messages[queued].msg_hdr.msg_iov = &iovecs[queued];
+			messages[queued].msg_hdr.msg_iovlen = 1;
+			messages[queued].msg_hdr.msg_name = &client.address;
+			messages[queued].msg_hdr.msg_namelen = sizeof(client.address);
+			queued += 1;
+			if (queued == Batch) flush();
+		}
+	}
+	flush();
+}
+
+void Shard::publish() {
+	stats.matches = 0;
+	stats.clients = 0;
+	for (auto const &match : matches) {
+		if (!match.active) continue;
+		stats.matches += 1;
+		stats.clients += uint32_t(match.clients[0].joined) + uint32_t(match.clients[1].joined);
+	}
+	{
+		std::unique_lock< std::mutex > lock(published_lock);
+		published.add(stats);
+	}
+	ShardStats fresh;
+	stats = fresh;
+}
+
+//---------------------------
+
+static void print_report(char const *label, ShardStats const &total, double seconds, uint32_t shards) {
+	double cores_busy = total.busy / seconds;
+	std::cout << label << ": " << total.matches << " matches (" << total.clients << " clients), "
+		<< (total.finished / seconds) << " finished/sec | "
+		<< (total.ticks / seconds / shards) << " ticks/sec/shard, " << total.missed << " dropped | tick lateness p50 "
+		<< (total.lateness.percentile(0.5) * 1e6) << "us, p99 " << (total.lateness.percentile(0.99) * 1e6) << "us, worst "
+		<< (total.lateness.worst * 1e6) << "us | " << cores_busy << " cores busy";
+	if (cores_busy > 0.0) std::cout << ", " << (total.matches / cores_busy) << " matches/core";
+	std::cout << " | packets in " << (total.packets_in / seconds) << "/s, out " << (total.packets_out / seconds) << "/s" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	struct {
+		uint16_t port = 7777; //shard i listens on port + i
+		uint32_t shards = 0; //0 = one per core
+		uint32_t slots = 1024; //matches per shard
+		uint32_t bots = 0;
+		float seconds = 0.0f; //0 = until killed
+		float report = 5.0f;
+	} config;
+
+	bool ok = true;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		bool has_value = (argi + 1 < argc);
+		std::string value = (has_value ? argv[argi + 1] : "");
+		if (!has_value) {
+			ok = false;
+		} else if (arg == "--port") {
+			config.port = uint16_t(std::atoi(value.c_str()));
+		} else if (arg == "--shards") {
+			config.shards = uint32_t(std::atoi(value.c_str()));
+		} else if (arg == "--slots") {
+			config.slots = uint32_t(std::max(1, std::atoi(value.c_str())));
+		} else if (arg == "--bots") {
+			config.bots = uint32_t(std::atoi(value.c_str()));
+		} else if (arg == "--seconds") {
+			config.seconds = float(std::atof(value.c_str()));
+		} else if (arg == "--report") {
+			config.report = std::max(0.1f, float(std::atof(value.c_str())));
+		} else {
+			ok = false;
+		}
+		if (!ok) break;
+		++argi;
+	}
+	if (config.shards == 0) config.shards = std::max(1U, std::thread::hardware_concurrency());
+	if (!ok || config.bots > config.shards * config.slots) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--port P] [--shards N] [--slots N] [--bots N] [--seconds S] [--report S]\n"
+			"\t(bots must fit in shards * slots matches)" << std::endl;
+		return 1;
+	}
+
+	std::vector< std::unique_ptr< Shard > > shards;
+	for (uint32_t s = 0; s < config.shards; ++s) {
+		shards.emplace_back(new Shard(s, config.shards, uint16_t(config.port + s), config.slots));
+	}
+	for (uint32_t b = 0; b < config.bots; ++b) {
+		Match &match = shards[b % config.shards]->matches[b / config.shards];
+		match.active = true;
+		match.bot = true;
+	}
+	std::cout << "server: " << config.shards << " shards on UDP ports " << config.port << "-" << (config.port + config.shards - 1)
+		<< ", " << config.slots << " matches each, " << config.bots << " bot matches" << std::endl;
+
+	std::atomic< bool > quit(false);
+	for (auto &shard : shards) {
+		Shard *s = shard.get();
+		shard->thread = std::thread([s, &quit]() { s->run(quit); });
+	}
+
+	auto start = Clock::now();
+	auto last_report = start;
+	ShardStats overall;
+	while (config.seconds <= 0.0f || std::chrono::duration< float >(Clock::now() - start).count() < config.seconds) {
+		std::this_thread::sleep_for(std::chrono::duration< float >(config.report));
+		ShardStats total;
+		uint32_t matches = 0, clients = 0;
+		for (auto &shard : shards) {
+			std::unique_lock< std::mutex > lock(shard->published_lock);
+			total.add(shard->published);
+			matches += shard->published.matches;
+			clients += shard->published.clients;
+			shard->published = ShardStats();
+		}
+		total.matches = matches;
+		total.clients = clients;
+		auto now = Clock::now();
+		print_report("  report", total, std::chrono::duration< double >(now - last_report).count(), config.shards);
+		last_report = now;
+		overall.add(total);
+	}
+
+	quit = true;
+	for (auto &shard : shards) {
+		shard->thread.join();
+	}
+	print_report("overall", overall, std::chrono::duration< double >(Clock::now() - start).count(), config.shards);
+
+	return 0;
+}